@@ -0,0 +1,48 @@
+#include "bench.h"
+
+// Local dependencies
+#include "options.h"
+
+// Global
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+static const double report_period_sec = 5;
+
+static std::vector<BenchReporter> reporters;
+static double period_start = -1;
+static int period_frames = 0;
+
+void bench_register(BenchReporter reporter)
+{
+    reporters.push_back(reporter);
+}
+
+void bench_appendf(std::string &out, const char *fmt, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    out += buf;
+}
+
+void bench_frame_end(double time)
+{
+    if (!options.bench) return;
+
+    if (period_start < 0) period_start = time;
+    ++period_frames;
+    double elapsed = time - period_start;
+    if (elapsed < report_period_sec) return;
+
+    std::string out;
+    for (auto reporter : reporters)
+        reporter(out, period_frames);
+    printf("\nBench: %d frames in %.1f sec (%.1f FPS)\n%s", period_frames, elapsed, period_frames / elapsed, out.c_str());
+
+    period_start = time;
+    period_frames = 0;
+}
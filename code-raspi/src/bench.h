@@ -0,0 +1,15 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+
+// Periodic performance report on stdout, enabled with --bench.
+// Each reporter appends lines covering the period that just ended, then resets its counters.
+typedef void (*BenchReporter)(std::string &out, int frames);
+
+void bench_register(BenchReporter reporter);
+void bench_appendf(std::string &out, const char *fmt, ...);
+// Call once per presented frame
+void bench_frame_end(double time);
+
+#endif
@@ -0,0 +1,159 @@
+#include "compile_worker.h"
+
+// Local dependencies
+#include "error.h"
+#include "horrors.h"
+#include "lock.h"
+#include "sketches/gl_state.h"
+#include "sketches/sketch_base.h"
+
+// Global
+#include <stdio.h>
+#include <string.h>
+
+CompileWorker::CompileWorker()
+{
+    int r = pthread_mutex_init(&mut, NULL);
+    if (r != 0) THROWF("Failed to initialize mutex: %d: %s", r, strerror(r));
+    r = pthread_cond_init(&cond, NULL);
+    if (r != 0) THROWF("Failed to initialize condition variable: %d: %s", r, strerror(r));
+
+    ctx = create_shared_context();
+    if (ctx == EGL_NO_CONTEXT)
+    {
+        printf("No shared EGL context; stations load on the render thread.\n");
+        return;
+    }
+    r = pthread_create(&thread, NULL, loop, this);
+    if (r != 0)
+    {
+        destroy_shared_context(ctx);
+        ctx = EGL_NO_CONTEXT;
+        THROWF("Failed to create thread: %d: %s", r, strerror(r));
+    }
+    thread_created = true;
+    thread_running = true;
+}
+
+CompileWorker::~CompileWorker()
+{
+    if (thread_created)
+    {
+        {
+            Lock lock(&mut);
+            quitting = true;
+            pthread_cond_signal(&cond);
+        }
+        // Lets a running init finish: its objects may be in use by the driver
+        pthread_join(thread, NULL);
+    }
+    for (auto &it : jobs)
+        if (it.second.fence) glDeleteSync(it.second.fence);
+    if (ctx != EGL_NO_CONTEXT) destroy_shared_context(ctx);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mut);
+}
+
+void CompileWorker::run(SketchBase *sketch, Job &job)
+{
+    try
+    {
+        sketch->init();
+    }
+    catch (std::exception &e)
+    {
+        job.error = e.what();
+    }
+    // The render thread deletes objects under this context's bindings; don't keep any
+    gl_unbind_objects();
+    if (ctx != EGL_NO_CONTEXT)
+    {
+        job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+}
+
+void *CompileWorker::loop(void *arg)
+{
+    CompileWorker *self = (CompileWorker *)arg;
+    if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, self->ctx))
+    {
+        fprintf(stderr, "Compile worker: eglMakeCurrent failed: %d. Stations load on the render thread.\n",
+                eglGetError());
+        // Jobs queued so far are run by init_done
+        Lock lock(&self->mut);
+        self->thread_running = false;
+        return nullptr;
+    }
+
+    while (true)
+    {
+        SketchBase *sketch = nullptr;
+        {
+            Lock lock(&self->mut);
+            while (!self->quitting && self->queue.empty())
+                pthread_cond_wait(&self->cond, &self->mut);
+            if (self->quitting) break;
+            sketch = self->queue.front();
+            self->queue.pop_front();
+        }
+
+        Job job = {true, 0, ""};
+        self->run(sketch, job);
+
+        Lock lock(&self->mut);
+        self->jobs[sketch] = job;
+    }
+
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return nullptr;
+}
+
+void CompileWorker::queue_init(SketchBase *sketch)
+{
+    Lock lock(&mut);
+    if (!thread_running)
+    {
+        Job job = {true, 0, ""};
+        run(sketch, job);
+        jobs[sketch] = job;
+        return;
+    }
+    jobs[sketch] = {false, 0, ""};
+    queue.push_back(sketch);
+    pthread_cond_signal(&cond);
+}
+
+// Caller holds mut; render thread only
+void CompileWorker::run_queued()
+{
+    while (!queue.empty())
+    {
+        SketchBase *sketch = queue.front();
+        queue.pop_front();
+        Job job = {true, 0, ""};
+        run(sketch, job);
+        jobs[sketch] = job;
+    }
+}
+
+bool CompileWorker::init_done(SketchBase *sketch)
+{
+    Job job;
+    {
+        Lock lock(&mut);
+        if (!thread_running) run_queued();
+        auto it = jobs.find(sketch);
+        if (it == jobs.end() || !it->second.done) return false;
+        job = it->second;
+        if (job.fence)
+        {
+            GLenum res = glClientWaitSync(job.fence, 0, 0);
+            if (res == GL_TIMEOUT_EXPIRED) return false;
+            glDeleteSync(job.fence);
+        }
+        jobs.erase(it);
+    }
+    if (!job.error.empty()) THROWF("Station failed to load: %s", job.error.c_str());
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef COMPILE_WORKER_H
+#define COMPILE_WORKER_H
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <deque>
+#include <map>
+#include <pthread.h>
+#include <string>
+
+class SketchBase;
+
+// Runs sketches' init() on a thread of its own, with an EGL context that shares objects with egl_ctx,
+// so that compiling and building textures never holds up the render thread.
+// Without a shared context (SDL2 window, no EGL_KHR_surfaceless_context) init runs synchronously when queued.
+class CompileWorker
+{
+  private:
+    struct Job
+    {
+        bool done;
+        // Signals when the GPU has finished the job's commands, e.g. rendering a generated texture
+        GLsync fence;
+        std::string error;
+    };
+    EGLContext ctx = EGL_NO_CONTEXT;
+    pthread_t thread;
+    bool thread_created = false;
+    // False if the thread couldn't make ctx current: jobs then run on the render thread
+    bool thread_running = false;
+    pthread_mutex_t mut;
+    pthread_cond_t cond;
+    bool quitting = false;
+    std::deque<SketchBase *> queue;
+    std::map<SketchBase *, Job> jobs;
+
+  private:
+    static void *loop(void *arg);
+    void run(SketchBase *sketch, Job &job);
+    void run_queued();
+
+  public:
+    CompileWorker();
+    ~CompileWorker();
+    // Queues sketch->init(); the sketch must not be used until init_done returns true
+    void queue_init(SketchBase *sketch);
+    // True once the sketch's init has run and the GPU has completed it; throws if init failed.
+    // Render thread only.
+    bool init_done(SketchBase *sketch);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "config.h"
+
+// Local dependencies
+#include "error.h"
+#include "file_helpers.h"
+#include "magic.h"
+#include "options.h"
+
+// Global
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const char *config_file_name = "igr.conf";
+
+static void set_visible_rect(const char *value, int line)
+{
+    int x, y, w, h;
+    if (sscanf(value, "%d %d %d %d", &x, &y, &w, &h) != 4)
+        THROWF("%s line %d: visible_rect needs x y w h", config_file_name, line);
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > W || y + h > H)
+        THROWF("%s line %d: visible_rect %d %d %d %d is outside %dx%d", config_file_name, line, x, y, w, h, W, H);
+    options.visible_rect[0] = x;
+    options.visible_rect[1] = y;
+    options.visible_rect[2] = w;
+    options.visible_rect[3] = h;
+}
+
+static void set_shader_cache(const char *value)
+{
+    std::string dir(value);
+    while (!dir.empty() && isspace((unsigned char)dir.back())) dir.pop_back();
+    options.shader_cache = dir == "off" ? "" : dir;
+}
+
+static void set_sysfs_root(const char *value)
+{
+    std::string dir(value);
+    while (!dir.empty() && isspace((unsigned char)dir.back())) dir.pop_back();
+    options.sysfs_root = dir;
+}
+
+static void set_gpu_budget(const char *value, int line)
+{
+    int mb;
+    if (sscanf(value, "%d", &mb) != 1 || mb <= 0)
+        THROWF("%s line %d: gpu_budget_mb needs a positive number", config_file_name, line);
+    options.gpu_budget = (size_t)mb << 20;
+}
+
+void load_config()
+{
+    std::string path;
+    path_from_bindir(config_file_name, path);
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return;
+
+    char buf[256];
+    int line = 0;
+    while (fgets(buf, sizeof(buf), f))
+    {
+        ++line;
+        char *hash = strchr(buf, '#');
+        if (hash) *hash = '\0';
+
+        char key[64];
+        int value_pos = 0;
+        if (sscanf(buf, " %63[a-z_] = %n", key, &value_pos) < 1) continue;
+        if (value_pos == 0)
+        {
+            fclose(f);
+            THROWF("%s line %d: expected key = value", config_file_name, line);
+        }
+        const char *value = buf + value_pos;
+
+        try
+        {
+            if (strcmp(key, "visible_rect") == 0) set_visible_rect(value, line);
+            else if (strcmp(key, "shader_cache") == 0) set_shader_cache(value);
+            else if (strcmp(key, "gpu_budget_mb") == 0) set_gpu_budget(value, line);
+            else if (strcmp(key, "sysfs_root") == 0) set_sysfs_root(value);
+            else fprintf(stderr, "%s line %d: ignoring unknown key '%s'\n", config_file_name, line, key);
+        }
+        catch (...)
+        {
+            fclose(f);
+            throw;
+        }
+    }
+    fclose(f);
+}
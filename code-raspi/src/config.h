@@ -0,0 +1,15 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Per-device settings from igr.conf next to the binary, applied to options; the file is optional.
+// One "key = value" per line; # starts a comment.
+//
+//   visible_rect = x y w h   Part of the 720x576 frame the CRT shows, from the top left.
+//                            Calibrate with the test-tuner action, which outlines it.
+//   shader_cache = dir       Where linked shader programs are cached, relative to the binary
+//                            unless absolute; "off" disables the cache. Default: shader-cache.
+//   gpu_budget_mb = n        GPU memory for keeping stations loaded after tuning away. Default: 32.
+//   sysfs_root = dir         Where to read temperatures and CPU clocks. Default: /sys.
+void load_config();
+
+#endif
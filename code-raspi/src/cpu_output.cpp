@@ -0,0 +1,225 @@
+#include "cpu_output.h"
+
+// Local dependencies
+#include "dumb_buffer.h"
+#include "error.h"
+#include "horrors.h"
+#include "magic.h"
+
+// Global
+#include <drm_fourcc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// DRM: front buffer is on screen, or will be once the pending flip lands
+static bool use_drm = false;
+static DumbBuffer bufs[2];
+static uint32_t drm_bpp = 0;
+static int front = 0;
+static bool flip_pending = false;
+
+// fbdev fallback
+static int fb_fd = -1;
+static uint8_t *fb_map = nullptr;
+static size_t fb_map_size = 0;
+static uint8_t *fb_pixels = nullptr;
+static uint32_t fb_pitch = 0;
+static uint32_t fb_bpp = 0;
+
+// Writes the image to 16 bpp RGB565 or 32 bpp XRGB8888 pixels, clipped to the target size
+static void convert(const float *image, uint8_t *dst, uint32_t pitch, uint32_t bpp, uint32_t width, uint32_t height)
+{
+    uint32_t w = width < W ? width : W;
+    uint32_t h = height < H ? height : H;
+    for (uint32_t y = 0; y < h; ++y)
+    {
+        const float *src = image + y * W * 4;
+        uint8_t *row = dst + y * pitch;
+        if (bpp == 16)
+        {
+            uint16_t *px = (uint16_t *)row;
+            for (uint32_t x = 0; x < w; ++x, src += 4)
+            {
+                unsigned r = (unsigned)(src[0] * 31.0f);
+                unsigned g = (unsigned)(src[1] * 63.0f);
+                unsigned b = (unsigned)(src[2] * 31.0f);
+                px[x] = (uint16_t)((r << 11) | (g << 5) | b);
+            }
+        }
+        else
+        {
+            uint32_t *px = (uint32_t *)row;
+            for (uint32_t x = 0; x < w; ++x, src += 4)
+            {
+                unsigned r = (unsigned)(src[0] * 255.0f);
+                unsigned g = (unsigned)(src[1] * 255.0f);
+                unsigned b = (unsigned)(src[2] * 255.0f);
+                px[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+            }
+        }
+    }
+}
+
+static void page_flip_handler(int, unsigned int, unsigned int, unsigned int, void *)
+{
+    flip_pending = false;
+}
+
+static void wait_for_cpu_flip()
+{
+    drmEventContext evctx;
+    memset(&evctx, 0, sizeof(evctx));
+    evctx.version = 2;
+    evctx.page_flip_handler = page_flip_handler;
+
+    pollfd pfd;
+    pfd.fd = drm_fd;
+    pfd.events = POLLIN;
+
+    while (flip_pending)
+    {
+        int ret = poll(&pfd, 1, 1000);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            THROWF_ERRNO("poll on DRM device failed");
+        }
+        if (ret == 0) THROWF("Page flip timed out");
+        drmHandleEvent(drm_fd, &evctx);
+    }
+}
+
+static void destroy_drm_buffers()
+{
+    for (int i = 0; i < 2; ++i)
+        destroy_dumb_buffer(drm_fd, bufs[i]);
+}
+
+static void init_drm_output(const char *device_path)
+{
+    init_kms(device_path);
+
+    // RGB565 like the composite output's fbdev; XRGB8888 for devices without it, e.g. older VKMS
+    const uint32_t formats[] = {DRM_FORMAT_RGB565, DRM_FORMAT_XRGB8888};
+    for (uint32_t format : formats)
+    {
+        try
+        {
+            for (int i = 0; i < 2; ++i)
+                create_dumb_buffer(drm_fd, mode.hdisplay, mode.vdisplay, format, bufs[i]);
+        }
+        catch (const igr_exception &)
+        {
+            destroy_drm_buffers();
+            continue;
+        }
+        // Dumb buffers start out zeroed: black until the first image
+        if (drmModeSetCrtc(drm_fd, crtc_id, bufs[0].fb_id, 0, 0, &conn->connector_id, 1, &mode) == 0)
+        {
+            drm_bpp = format == DRM_FORMAT_RGB565 ? 16 : 32;
+            front = 0;
+            use_drm = true;
+            return;
+        }
+        destroy_drm_buffers();
+    }
+    THROWF("No dumb buffer format could be scanned out");
+}
+
+static void init_fbdev_output()
+{
+    fb_fd = open(FB_PATH, O_RDWR);
+    if (fb_fd < 0)
+        THROWF_ERRNO("Failed to open '%s'", FB_PATH);
+
+    fb_var_screeninfo vinfo;
+    fb_fix_screeninfo finfo;
+    if (ioctl(fb_fd, FBIOGET_FSCREENINFO, &finfo) || ioctl(fb_fd, FBIOGET_VSCREENINFO, &vinfo))
+        THROWF_ERRNO("Failed to query '%s'", FB_PATH);
+
+    if (vinfo.xres != W || vinfo.yres != H)
+        THROWF("Framebuffer resolution (%d x %d) doesn't match image size of %d x %d", vinfo.xres, vinfo.yres, W, H);
+    if (vinfo.bits_per_pixel != 16 && vinfo.bits_per_pixel != 32)
+        THROWF("Expected 16 or 32 bits per pixel, got %d", vinfo.bits_per_pixel);
+
+    fb_map_size = vinfo.yres_virtual * finfo.line_length;
+    void *map = mmap(0, fb_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+    if (map == MAP_FAILED)
+        THROWF_ERRNO("Failed to map frame buffer to memory");
+    fb_map = (uint8_t *)map;
+    fb_pitch = finfo.line_length;
+    fb_bpp = vinfo.bits_per_pixel;
+    fb_pixels = fb_map + vinfo.yoffset * fb_pitch + vinfo.xoffset * (fb_bpp / 8);
+}
+
+void init_cpu_output(const char *device_path)
+{
+    if (device_path && device_path[0])
+    {
+        try
+        {
+            init_drm_output(device_path);
+            return;
+        }
+        catch (const igr_exception &e)
+        {
+            fprintf(stderr, "DRM output failed (%s); falling back to %s\n", e.what(), FB_PATH);
+            destroy_drm_buffers();
+            cleanup_kms();
+        }
+    }
+    init_fbdev_output();
+}
+
+void show_cpu_image(const float *image)
+{
+    if (!use_drm)
+    {
+        convert(image, fb_pixels, fb_pitch, fb_bpp, W, H);
+        return;
+    }
+
+    // The back buffer is still on screen until the previous flip lands
+    if (flip_pending) wait_for_cpu_flip();
+    int back = 1 - front;
+    DumbBuffer &buf = bufs[back];
+    convert(image, buf.map, buf.pitch, drm_bpp, buf.width, buf.height);
+    if (drmModePageFlip(drm_fd, crtc_id, buf.fb_id, DRM_MODE_PAGE_FLIP_EVENT, nullptr))
+        THROWF_ERRNO("drmModePageFlip failed");
+    flip_pending = true;
+    front = back;
+}
+
+void cleanup_cpu_output()
+{
+    if (use_drm)
+    {
+        if (flip_pending)
+        {
+            try
+            {
+                wait_for_cpu_flip();
+            }
+            catch (const igr_exception &)
+            {
+                flip_pending = false;
+            }
+        }
+        destroy_drm_buffers();
+        cleanup_kms();
+        use_drm = false;
+    }
+
+    if (fb_map) munmap(fb_map, fb_map_size);
+    fb_map = nullptr;
+    fb_pixels = nullptr;
+    if (fb_fd >= 0) close(fb_fd);
+    fb_fd = -1;
+}
@@ -0,0 +1,11 @@
+#ifndef CPU_OUTPUT_H
+#define CPU_OUTPUT_H
+
+// Display for the CPU-drawn modes (calibrate, test tuner), which render W x H float RGBA images.
+// With a DRM device: two dumb buffers, mapped once and page-flipped on vblank.
+// Without one, or if KMS setup fails: the fbdev at FB_PATH, also mapped once.
+void init_cpu_output(const char *device_path);
+void show_cpu_image(const float *image);
+void cleanup_cpu_output();
+
+#endif
@@ -0,0 +1,63 @@
+#include "dumb_buffer.h"
+
+// Local dependencies
+#include "error.h"
+
+// Global
+#include <drm_fourcc.h>
+#include <sys/mman.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+void create_dumb_buffer(int fd, uint32_t width, uint32_t height, uint32_t format, DumbBuffer &buf)
+{
+    drm_mode_create_dumb creq = {};
+    creq.width = width;
+    creq.height = height;
+    creq.bpp = format == DRM_FORMAT_RGB565 ? 16 : 32;
+    if (drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq))
+        THROWF_ERRNO("Failed to create %ux%u dumb buffer", width, height);
+
+    buf.width = width;
+    buf.height = height;
+    buf.pitch = creq.pitch;
+    buf.handle = creq.handle;
+    buf.size = creq.size;
+
+    uint32_t handles[4] = {buf.handle, 0, 0, 0};
+    uint32_t pitches[4] = {buf.pitch, 0, 0, 0};
+    uint32_t offsets[4] = {0, 0, 0, 0};
+    if (drmModeAddFB2(fd, width, height, format, handles, pitches, offsets, &buf.fb_id, 0))
+    {
+        destroy_dumb_buffer(fd, buf);
+        THROWF_ERRNO("drmModeAddFB2 failed for dumb buffer");
+    }
+
+    drm_mode_map_dumb mreq = {};
+    mreq.handle = buf.handle;
+    if (drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq))
+    {
+        destroy_dumb_buffer(fd, buf);
+        THROWF_ERRNO("Failed to map dumb buffer");
+    }
+    void *map = mmap(0, buf.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mreq.offset);
+    if (map == MAP_FAILED)
+    {
+        destroy_dumb_buffer(fd, buf);
+        THROWF_ERRNO("Failed to mmap dumb buffer");
+    }
+    buf.map = (uint8_t *)map;
+}
+
+void destroy_dumb_buffer(int fd, DumbBuffer &buf)
+{
+    if (buf.map) munmap(buf.map, buf.size);
+    if (buf.fb_id) drmModeRmFB(fd, buf.fb_id);
+    if (buf.handle)
+    {
+        drm_mode_destroy_dumb dreq = {};
+        dreq.handle = buf.handle;
+        drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
+    }
+    buf = DumbBuffer();
+}
@@ -0,0 +1,22 @@
+#ifndef DUMB_BUFFER_H
+#define DUMB_BUFFER_H
+
+#include <stdint.h>
+
+// CPU-mapped DRM dumb buffer with a scanout FB
+struct DumbBuffer
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pitch = 0;
+    uint32_t handle = 0;
+    uint32_t fb_id = 0;
+    uint64_t size = 0;
+    uint8_t *map = nullptr;
+};
+
+// Format is a DRM fourcc with 16 or 32 bits per pixel
+void create_dumb_buffer(int fd, uint32_t width, uint32_t height, uint32_t format, DumbBuffer &buf);
+void destroy_dumb_buffer(int fd, DumbBuffer &buf);
+
+#endif
@@ -4,11 +4,13 @@
 #include <math.h>
 #include <unistd.h>
 
-FPS::FPS(int target_fps)
+FPS::FPS(int target_fps, bool throttle)
     : target_fps(target_fps)
     , cycle_usec(1000000 / target_fps)
     , buf_size(target_fps)
+    , throttle(throttle)
     , ix(0)
+    , last_elapsed_usec(0)
 {
     elapsec_usec = new long[buf_size];
     for (int i = 0; i < buf_size; ++i)
@@ -53,6 +55,7 @@ void FPS::frame_end()
     timeval ts_end;
     gettimeofday(&ts_end, nullptr);
     long elapsed = calc_elapsed_usec(ts_start, ts_end);
+    last_elapsed_usec = elapsed;
 
     long to_store = elapsed < cycle_usec ? cycle_usec : elapsed;
     elapsec_usec[ix] = to_store;
@@ -65,6 +68,6 @@ void FPS::frame_end()
     double avg_fps = 1000000.0 / (double)avg_elapsed;
     printf("FPS %5.1f / last frame %.2f msec (~%d FPS)    \r", avg_fps, elapsed_msec, extrapolated_fps);
 
-    if (elapsed >= cycle_usec) return;
+    if (!throttle || elapsed >= cycle_usec) return;
     usleep(cycle_usec - elapsed);
 }
@@ -10,8 +10,10 @@ class FPS
     const int target_fps;
     const long cycle_usec;
     const int buf_size;
+    bool throttle;
     long *elapsec_usec;
     int ix;
+    long last_elapsed_usec;
     timeval ts_init;
     timeval ts_start;
 
@@ -19,9 +21,14 @@ class FPS
     long get_avg_elapsed();
 
   public:
-    FPS(int target_fps);
+    // If throttle is false, pacing is left to the caller (e.g., vsynced presentation)
+    FPS(int target_fps, bool throttle = true);
     double frame_start();
     void frame_end();
+    // E.g. when presentation falls back from vsynced flips
+    void set_throttle(bool throttle) { this->throttle = throttle; }
+    // Duration of the last frame, from frame_start to frame_end before any throttling sleep
+    double last_frame_sec() const { return last_elapsed_usec / 1000000.0; }
 };
 
 #endif
@@ -0,0 +1,81 @@
+#include "frame_pacer.h"
+
+// Local dependencies
+#include "bench.h"
+#include "options.h"
+
+// Global
+#include <GLES3/gl3.h>
+#include <deque>
+#include <time.h>
+
+struct InFlight
+{
+    GLsync fence;
+    double submitted;
+};
+
+// Oldest first
+static std::deque<InFlight> in_flight;
+
+static double wait_sec = 0;
+static double latency_sec = 0;
+static int completed = 0;
+
+static double now_sec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void retire_oldest()
+{
+    InFlight &f = in_flight.front();
+    glDeleteSync(f.fence);
+    latency_sec += now_sec() - f.submitted;
+    ++completed;
+    in_flight.pop_front();
+}
+
+void pace_frame()
+{
+    double now = now_sec();
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (fence == 0)
+    {
+        glFinish();
+        return;
+    }
+    in_flight.push_back({fence, now});
+
+    // Retire what's done already, so latency is measured close to completion
+    while (in_flight.size() > 1 && glClientWaitSync(in_flight.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+        retire_oldest();
+
+    // Leave room for the frame the CPU builds next: block on the oldest frame, which may be this one.
+    // Flushing makes sure the fence can signal.
+    while ((int)in_flight.size() >= options.frames_in_flight)
+    {
+        GLenum res;
+        do res = glClientWaitSync(in_flight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+        while (res == GL_TIMEOUT_EXPIRED);
+        retire_oldest();
+    }
+    wait_sec += now_sec() - now;
+}
+
+void cleanup_frame_pacer()
+{
+    for (auto &f : in_flight) glDeleteSync(f.fence);
+    in_flight.clear();
+}
+
+void report_frame_pacing(std::string &out, int frames)
+{
+    bench_appendf(out, "  Frame pacing (%d in flight): CPU waited %.2f ms/frame; submit to GPU done %.2f ms\n",
+                  options.frames_in_flight, wait_sec * 1000 / frames, completed ? latency_sec * 1000 / completed : 0.0);
+    wait_sec = 0;
+    latency_sec = 0;
+    completed = 0;
+}
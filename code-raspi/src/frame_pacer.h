@@ -0,0 +1,17 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <string>
+
+// Keeps at most options.frames_in_flight frames in flight, counting the one the CPU builds next, with a fence
+// per frame instead of draining the GPU with glFinish every frame: returns once fewer are outstanding on the
+// GPU. With 1 it waits for each frame to finish, like glFinish; with 2 the GPU may work on one frame while
+// the CPU builds the next.
+// Call once per frame, after the frame's last GL command and before presenting it.
+void pace_frame();
+void cleanup_frame_pacer();
+
+// Bench reporter: time the CPU waited for the GPU, and how long frames took from submission to completion
+void report_frame_pacing(std::string &out, int frames);
+
+#endif
@@ -1,11 +1,16 @@
 #include "horrors.h"
 
 // Local dependencies
+#include "dumb_buffer.h"
 #include "error.h"
+#include "frame_pacer.h"
 #include "main.h"
 #include "magic.h"
+#include "options.h"
 
 // Global
+#include <cerrno>
+#include <drm_fourcc.h>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
@@ -13,7 +18,9 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <fstream>
+#include <poll.h>
 #include <unistd.h>
+#include <vector>
 #if HAS_SDL2
 #include <SDL2/SDL.h>
 #endif
@@ -29,9 +36,10 @@ gbm_surface *gbm_surf = nullptr;
 EGLDisplay egl_display = EGL_NO_DISPLAY;
 EGLContext egl_ctx = EGL_NO_CONTEXT;
 EGLSurface egl_surf = EGL_NO_SURFACE;
+static EGLConfig egl_cfg = nullptr;
 gbm_bo *bo = nullptr;
-uint32_t fb_id = 0;
-uint32_t prev_fb_id = 0;
+gbm_bo *pending_bo = nullptr;
+uint32_t crtc_id = 0;
 bool kms_scanout_enabled = true;
 bool use_sdl_window = false;
 #if HAS_SDL2
@@ -39,6 +47,67 @@ static SDL_Window *sdl_window = nullptr;
 static SDL_GLContext sdl_gl_ctx = nullptr;
 #endif
 
+// Atomic KMS: property IDs are looked up once at init
+struct PlaneProps
+{
+    uint32_t fb_id = 0;
+    uint32_t crtc_id = 0;
+    uint32_t src_x = 0;
+    uint32_t src_y = 0;
+    uint32_t src_w = 0;
+    uint32_t src_h = 0;
+    uint32_t crtc_x = 0;
+    uint32_t crtc_y = 0;
+    uint32_t crtc_w = 0;
+    uint32_t crtc_h = 0;
+    uint32_t in_fence_fd = 0;
+    uint32_t zpos = 0;
+};
+struct KmsProps
+{
+    uint32_t conn_crtc_id = 0;
+    uint32_t crtc_mode_id = 0;
+    uint32_t crtc_active = 0;
+    PlaneProps primary;
+    PlaneProps overlay;
+};
+static KmsProps kms_props;
+static uint32_t primary_plane_id = 0;
+static uint32_t mode_blob_id = 0;
+static bool atomic_modeset_done = false;
+// Leaving atomic presentation mid-run: planes may be scaled, so the next frame goes through a modeset
+static bool crtc_reset_needed = false;
+
+// Overlay plane: two CPU-written buffers, alternated on each commit with a new image.
+// Uploads go to a staging copy first: until the previous flip lands, either buffer may be on screen.
+static uint32_t overlay_plane_id = 0;
+static uint64_t overlay_zpos = 0;
+static DumbBuffer overlay_bufs[2];
+// Buffer of the last successful commit
+static int overlay_buf_ix = 0;
+static std::vector<uint8_t> overlay_staging;
+static bool overlay_new_image = false;
+static int overlay_x = 0, overlay_y = 0;
+static bool overlay_visible = false;
+static bool overlay_dirty = false;
+
+// Primary plane source: the bottom-left part of the buffer the GPU rendered, scaled up to the full mode
+static bool scanout_scaling = false;
+static int scanout_w = 0, scanout_h = 0;
+static bool scanout_dirty = false;
+
+// Vblank sequence of the last completed flip; counts fields in interlaced modes
+static unsigned int flip_sequence = 0;
+static unsigned int unsynced_frames = 0;
+
+// EGL_ANDROID_native_fence_sync entry points; null if the extension is missing
+static PFNEGLCREATESYNCKHRPROC egl_create_sync = nullptr;
+static PFNEGLDESTROYSYNCKHRPROC egl_destroy_sync = nullptr;
+static PFNEGLDUPNATIVEFENCEFDANDROIDPROC egl_dup_native_fence_fd = nullptr;
+
+static void wait_for_flip();
+static void drop_overlay_plane();
+
 static bool is_raspberry_pi()
 {
     std::ifstream model_file("/sys/firmware/devicetree/base/model");
@@ -78,16 +147,24 @@ void cleanup_horrors()
         use_sdl_window = false;
     }
 
+    // Let a queued flip land before releasing its buffer; after a flip timed out, don't wait again
+    if (pending_bo && options.present_mode != pmLegacy) wait_for_flip();
+    if (pending_bo)
+    {
+        gbm_surface_release_buffer(gbm_surf, pending_bo);
+        pending_bo = nullptr;
+    }
     if (bo)
     {
-        // Remove fb and release BO
-        if (fb_id) drmModeRmFB(drm_fd, fb_id);
+        // Release BO; its cached FB is removed when the surface destroys it
         gbm_surface_release_buffer(gbm_surf, bo);
+        bo = nullptr;
     }
 
     // Uninit EGL
     if (egl_display != EGL_NO_DISPLAY)
     {
+        cleanup_frame_pacer();
         eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         if (egl_ctx != EGL_NO_CONTEXT) eglDestroyContext(egl_display, egl_ctx);
         if (egl_surf != EGL_NO_SURFACE) eglDestroySurface(egl_display, egl_surf);
@@ -96,19 +173,11 @@ void cleanup_horrors()
 
     if (gbm_surf) gbm_surface_destroy(gbm_surf);
     if (gbm_dev) gbm_device_destroy(gbm_dev);
+    if (mode_blob_id) drmModeDestroyPropertyBlob(drm_fd, mode_blob_id);
+    for (int i = 0; i < 2; ++i)
+        destroy_dumb_buffer(drm_fd, overlay_bufs[i]);
 
-    // Restore saved CRTC if we saved one
-    if (saved_crtc)
-    {
-        drmModeSetCrtc(drm_fd, saved_crtc->crtc_id, saved_crtc->buffer_id,
-                       saved_crtc->x, saved_crtc->y, &conn->connector_id, 1, &saved_crtc->mode);
-        drmModeFreeCrtc(saved_crtc);
-    }
-
-    if (enc) drmModeFreeEncoder(enc);
-    if (conn) drmModeFreeConnector(conn);
-    if (resources != nullptr) drmModeFreeResources(resources);
-    if (drm_fd >= 0) close(drm_fd);
+    cleanup_kms();
 }
 
 static void list_connectors()
@@ -192,15 +261,45 @@ static void init_egl()
         EGL_GREEN_SIZE, 8,
         EGL_BLUE_SIZE, 8,
         EGL_ALPHA_SIZE, 8,
-        EGL_DEPTH_SIZE, 24,
+        EGL_DEPTH_SIZE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_NONE};
+    EGLint cfg_attribs_565[] = {
+        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_RED_SIZE, 5,
+        EGL_GREEN_SIZE, 6,
+        EGL_BLUE_SIZE, 5,
+        EGL_ALPHA_SIZE, 0,
+        EGL_DEPTH_SIZE, 0,
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
         EGL_NONE};
     EGLConfig cfg;
     EGLint num_cfg;
-    if (!eglChooseConfig(egl_display, cfg_attribs, &cfg, 1, &num_cfg) || num_cfg < 1)
-        THROWF("eglChooseConfig failed: %d", eglGetError());
+    if (!options.rgb565)
+    {
+        if (!eglChooseConfig(egl_display, cfg_attribs, &cfg, 1, &num_cfg) || num_cfg < 1)
+            THROWF("eglChooseConfig failed: %d", eglGetError());
+    }
+    else
+    {
+        // Config sizes are minimums, so 8888 configs match too: pick the one whose visual is RGB565
+        EGLConfig cfgs[64];
+        if (!eglChooseConfig(egl_display, cfg_attribs_565, cfgs, 64, &num_cfg) || num_cfg < 1)
+            THROWF("eglChooseConfig failed: %d", eglGetError());
+        // The gbm surface is RGB565: a config of another visual can't render to it
+        int found = -1;
+        for (int i = 0; i < num_cfg && found < 0; ++i)
+        {
+            EGLint visual_id = 0;
+            eglGetConfigAttrib(egl_display, cfgs[i], EGL_NATIVE_VISUAL_ID, &visual_id);
+            if (visual_id == GBM_FORMAT_RGB565) found = i;
+        }
+        if (found < 0) THROWF("No EGL config with an RGB565 visual among %d; run without --rgb565", num_cfg);
+        cfg = cfgs[found];
+    }
 
     EGLint ctx_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    egl_cfg = cfg;
     egl_ctx = eglCreateContext(egl_display, cfg, EGL_NO_CONTEXT, ctx_attribs);
     if (egl_ctx == EGL_NO_CONTEXT) THROWF("eglCreateContext failed: %d", eglGetError());
 
@@ -211,15 +310,17 @@ static void init_egl()
         THROWF("eglMakeCurrent failed: %d", eglGetError());
 }
 
-static bool set_crtc(drmModeModeInfo mode, uint32_t fb_id)
+static uint32_t pick_crtc()
 {
-    uint32_t crtc_id = 0;
     // Prefer encoder's crtc, else first available
-    if (enc && enc->crtc_id) crtc_id = enc->crtc_id;
-    else if (resources->count_crtcs > 0) crtc_id = resources->crtcs[0];
-
-    if (!crtc_id) THROWF("No available CRTC");
+    if (enc && enc->crtc_id) return enc->crtc_id;
+    if (resources->count_crtcs > 0) return resources->crtcs[0];
+    THROWF("No available CRTC");
+    return 0; // Shut up compiler
+}
 
+static bool set_crtc(drmModeModeInfo mode, uint32_t fb_id)
+{
     int ret = drmModeSetCrtc(drm_fd, crtc_id, fb_id, 0, 0, &conn->connector_id, 1, &mode);
     if (ret)
     {
@@ -235,6 +336,246 @@ static bool set_crtc(drmModeModeInfo mode, uint32_t fb_id)
     return true;
 }
 
+static uint32_t get_prop_id(uint32_t obj_id, uint32_t obj_type, const char *name, uint64_t *value = nullptr)
+{
+    drmModeObjectPropertiesPtr props = drmModeObjectGetProperties(drm_fd, obj_id, obj_type);
+    if (!props) return 0;
+    uint32_t id = 0;
+    for (uint32_t i = 0; id == 0 && i < props->count_props; ++i)
+    {
+        drmModePropertyPtr prop = drmModeGetProperty(drm_fd, props->props[i]);
+        if (!prop) continue;
+        if (strcmp(prop->name, name) == 0)
+        {
+            id = prop->prop_id;
+            if (value) *value = props->prop_values[i];
+        }
+        drmModeFreeProperty(prop);
+    }
+    drmModeFreeObjectProperties(props);
+    return id;
+}
+
+static int get_crtc_index()
+{
+    for (int i = 0; i < resources->count_crtcs; ++i)
+        if (resources->crtcs[i] == crtc_id) return i;
+    return -1;
+}
+
+static bool plane_supports_format(drmModePlanePtr plane, uint32_t format)
+{
+    for (uint32_t i = 0; i < plane->count_formats; ++i)
+        if (plane->formats[i] == format) return true;
+    return false;
+}
+
+// Finds a plane of the given type usable on our CRTC; format 0 means any
+static uint32_t find_plane(uint64_t plane_type, uint32_t format = 0)
+{
+    int crtc_ix = get_crtc_index();
+    drmModePlaneResPtr planes = drmModeGetPlaneResources(drm_fd);
+    if (!planes || crtc_ix < 0) return 0;
+
+    uint32_t res = 0;
+    for (uint32_t i = 0; res == 0 && i < planes->count_planes; ++i)
+    {
+        drmModePlanePtr plane = drmModeGetPlane(drm_fd, planes->planes[i]);
+        if (!plane) continue;
+        uint64_t type = 0;
+        if ((plane->possible_crtcs & (1 << crtc_ix)) &&
+            (format == 0 || plane_supports_format(plane, format)) &&
+            get_prop_id(plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", &type) && type == plane_type)
+        {
+            res = plane->plane_id;
+        }
+        drmModeFreePlane(plane);
+    }
+    drmModeFreePlaneResources(planes);
+    return res;
+}
+
+// Looks up a plane's properties; IN_FENCE_FD and zpos are optional
+static bool get_plane_props(uint32_t plane_id, PlaneProps &pp)
+{
+    pp.fb_id = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+    pp.crtc_id = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+    pp.src_x = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+    pp.src_y = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+    pp.src_w = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+    pp.src_h = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+    pp.crtc_x = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+    pp.crtc_y = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+    pp.crtc_w = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+    pp.crtc_h = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+    pp.in_fence_fd = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "IN_FENCE_FD");
+    pp.zpos = get_prop_id(plane_id, DRM_MODE_OBJECT_PLANE, "zpos");
+    return pp.fb_id && pp.crtc_id && pp.src_x && pp.src_y && pp.src_w && pp.src_h &&
+           pp.crtc_x && pp.crtc_y && pp.crtc_w && pp.crtc_h;
+}
+
+// Adds a plane's source rectangle to an atomic request; SRC_* is in 16.16 fixed point
+static void add_plane_src(drmModeAtomicReqPtr req, uint32_t plane_id, const PlaneProps &pp,
+                          uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+    drmModeAtomicAddProperty(req, plane_id, pp.src_x, (uint64_t)x << 16);
+    drmModeAtomicAddProperty(req, plane_id, pp.src_y, (uint64_t)y << 16);
+    drmModeAtomicAddProperty(req, plane_id, pp.src_w, (uint64_t)w << 16);
+    drmModeAtomicAddProperty(req, plane_id, pp.src_h, (uint64_t)h << 16);
+}
+
+// Primary plane shows the bottom-left scanout_w x scanout_h of the buffer (GL's origin is bottom left)
+static void add_primary_src(drmModeAtomicReqPtr req)
+{
+    add_plane_src(req, primary_plane_id, kms_props.primary, 0, mode.vdisplay - scanout_h, scanout_w, scanout_h);
+}
+
+// Adds a plane's full state to an atomic request, unscaled
+static void add_plane_state(drmModeAtomicReqPtr req, uint32_t plane_id, const PlaneProps &pp, uint32_t fb_id,
+                            int x, int y, uint32_t w, uint32_t h)
+{
+    drmModeAtomicAddProperty(req, plane_id, pp.crtc_id, fb_id ? crtc_id : 0);
+    drmModeAtomicAddProperty(req, plane_id, pp.fb_id, fb_id);
+    if (!fb_id) return;
+    add_plane_src(req, plane_id, pp, 0, 0, w, h);
+    drmModeAtomicAddProperty(req, plane_id, pp.crtc_x, x);
+    drmModeAtomicAddProperty(req, plane_id, pp.crtc_y, y);
+    drmModeAtomicAddProperty(req, plane_id, pp.crtc_w, w);
+    drmModeAtomicAddProperty(req, plane_id, pp.crtc_h, h);
+}
+
+// Sets up atomic modesetting; returns false if the driver can't do it
+static bool init_atomic()
+{
+    if (drmSetClientCap(drm_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) ||
+        drmSetClientCap(drm_fd, DRM_CLIENT_CAP_ATOMIC, 1))
+    {
+        fprintf(stderr, "Atomic modesetting not supported by driver.\n");
+        return false;
+    }
+
+    primary_plane_id = find_plane(DRM_PLANE_TYPE_PRIMARY);
+    if (!primary_plane_id)
+    {
+        fprintf(stderr, "No primary plane found for CRTC %u.\n", crtc_id);
+        return false;
+    }
+
+    KmsProps &p = kms_props;
+    p.conn_crtc_id = get_prop_id(conn->connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+    p.crtc_mode_id = get_prop_id(crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+    p.crtc_active = get_prop_id(crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+    if (!p.conn_crtc_id || !p.crtc_mode_id || !p.crtc_active || !get_plane_props(primary_plane_id, p.primary))
+    {
+        fprintf(stderr, "Missing atomic KMS properties.\n");
+        return false;
+    }
+
+    if (drmModeCreatePropertyBlob(drm_fd, &mode, sizeof(mode), &mode_blob_id))
+    {
+        fprintf(stderr, "Failed to create mode blob: %d: %s\n", errno, strerror(errno));
+        return false;
+    }
+
+    printf("Using atomic KMS, primary plane %u%s.\n", primary_plane_id,
+           p.primary.in_fence_fd ? " with in-fences" : "");
+    return true;
+}
+
+// First commit does the modeset (blocking); later ones are non-blocking flips
+static int atomic_commit(uint32_t fb_id, int in_fence_fd)
+{
+    const KmsProps &p = kms_props;
+    drmModeAtomicReqPtr req = drmModeAtomicAlloc();
+    if (!req) THROWF("drmModeAtomicAlloc failed");
+
+    uint32_t flags = DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+    if (!atomic_modeset_done)
+    {
+        flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+        drmModeAtomicAddProperty(req, conn->connector_id, p.conn_crtc_id, crtc_id);
+        drmModeAtomicAddProperty(req, crtc_id, p.crtc_mode_id, mode_blob_id);
+        drmModeAtomicAddProperty(req, crtc_id, p.crtc_active, 1);
+        add_plane_state(req, primary_plane_id, p.primary, fb_id, 0, 0, mode.hdisplay, mode.vdisplay);
+    }
+    else
+    {
+        drmModeAtomicAddProperty(req, primary_plane_id, p.primary.fb_id, fb_id);
+        if (scanout_dirty) add_primary_src(req);
+    }
+    if (in_fence_fd >= 0 && p.primary.in_fence_fd)
+        drmModeAtomicAddProperty(req, primary_plane_id, p.primary.in_fence_fd, in_fence_fd);
+
+    // Overlay plane only changes when it's shown, hidden, or gets new content.
+    // Any previous flip has landed: only overlay_buf_ix is on screen, the other one is free to write.
+    int overlay_ix = overlay_buf_ix;
+    if (overlay_plane_id && overlay_dirty)
+    {
+        if (overlay_new_image)
+        {
+            overlay_ix = 1 - overlay_buf_ix;
+            DumbBuffer &buf = overlay_bufs[overlay_ix];
+            for (uint32_t y = 0; y < buf.height; ++y)
+                memcpy(buf.map + y * buf.pitch, &overlay_staging[y * buf.width * 4], buf.width * 4);
+        }
+        const DumbBuffer &obuf = overlay_bufs[overlay_ix];
+        uint32_t ofb = overlay_visible ? obuf.fb_id : 0;
+        add_plane_state(req, overlay_plane_id, p.overlay, ofb, overlay_x, overlay_y, obuf.width, obuf.height);
+        if (ofb && p.overlay.zpos) drmModeAtomicAddProperty(req, overlay_plane_id, p.overlay.zpos, overlay_zpos);
+    }
+
+    int ret = drmModeAtomicCommit(drm_fd, req, flags, nullptr);
+    drmModeAtomicFree(req);
+    if (ret == 0)
+    {
+        overlay_dirty = scanout_dirty = false;
+        if (overlay_new_image) overlay_buf_ix = overlay_ix;
+        overlay_new_image = false;
+    }
+    return ret;
+}
+
+// Checks with a test-only commit if the primary plane can scale up a half-size source
+static void test_plane_scaling(uint32_t fb_id)
+{
+    drmModeAtomicReqPtr req = drmModeAtomicAlloc();
+    if (!req) return;
+    drmModeAtomicAddProperty(req, primary_plane_id, kms_props.primary.fb_id, fb_id);
+    add_plane_src(req, primary_plane_id, kms_props.primary,
+                  0, mode.vdisplay - mode.vdisplay / 2, mode.hdisplay / 2, mode.vdisplay / 2);
+    scanout_scaling = drmModeAtomicCommit(drm_fd, req, DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+    drmModeAtomicFree(req);
+    printf("Primary plane scaling %s.\n", scanout_scaling ? "available" : "not available; GPU upscales");
+}
+
+static void init_native_fences()
+{
+    const char *exts = eglQueryString(egl_display, EGL_EXTENSIONS);
+    if (!exts || !strstr(exts, "EGL_ANDROID_native_fence_sync") || !kms_props.primary.in_fence_fd)
+    {
+        printf("No explicit GPU fences; CPU will wait for the GPU before each flip.\n");
+        return;
+    }
+    egl_create_sync = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+    egl_destroy_sync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+    egl_dup_native_fence_fd = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC)eglGetProcAddress("eglDupNativeFenceFDANDROID");
+    if (!egl_create_sync || !egl_destroy_sync || !egl_dup_native_fence_fd)
+        egl_dup_native_fence_fd = nullptr;
+}
+
+// Fence FD that signals when the GPU has finished all work submitted so far; -1 on failure
+static int create_render_fence()
+{
+    EGLint attribs[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID, EGL_NONE};
+    EGLSyncKHR sync = egl_create_sync(egl_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+    if (sync == EGL_NO_SYNC_KHR) return -1;
+    // The native fence only materializes once the commands are flushed
+    glFlush();
+    int fd = egl_dup_native_fence_fd(egl_display, sync);
+    egl_destroy_sync(egl_display, sync);
+    return fd;
+}
+
 #if HAS_SDL2
 static void init_sdl_window()
 {
@@ -268,19 +609,8 @@ static void init_sdl_window()
 }
 #endif
 
-void init_horrors(const char *device_path)
+void init_kms(const char *device_path)
 {
-    if (!should_use_drm_backend())
-    {
-#if HAS_SDL2
-        init_sdl_window();
-        return;
-#else
-        THROWF("Desktop output requires SDL2, but this binary was built without SDL2 support");
-#endif
-    }
-
-    kms_scanout_enabled = true;
     printf("Initializing video device: %s\n", device_path);
     drm_fd = open(device_path, O_RDWR | O_CLOEXEC);
     if (drm_fd < 0) THROWF_ERRNO("Failed to open device '%s'", device_path);
@@ -296,6 +626,46 @@ void init_horrors(const char *device_path)
 
     // Pick preferred or first mode
     mode = get_first_or_preferred_mode();
+    crtc_id = pick_crtc();
+}
+
+void cleanup_kms()
+{
+    // Restore saved CRTC if we saved one
+    if (saved_crtc)
+    {
+        drmModeSetCrtc(drm_fd, saved_crtc->crtc_id, saved_crtc->buffer_id,
+                       saved_crtc->x, saved_crtc->y, &conn->connector_id, 1, &saved_crtc->mode);
+        drmModeFreeCrtc(saved_crtc);
+        saved_crtc = nullptr;
+    }
+
+    if (enc) drmModeFreeEncoder(enc);
+    enc = nullptr;
+    if (conn) drmModeFreeConnector(conn);
+    conn = nullptr;
+    if (resources != nullptr) drmModeFreeResources(resources);
+    resources = nullptr;
+    if (drm_fd >= 0) close(drm_fd);
+    drm_fd = -1;
+}
+
+void init_horrors(const char *device_path)
+{
+    if (!should_use_drm_backend())
+    {
+#if HAS_SDL2
+        init_sdl_window();
+        return;
+#else
+        THROWF("Desktop output requires SDL2, but this binary was built without SDL2 support");
+#endif
+    }
+
+    kms_scanout_enabled = true;
+    init_kms(device_path);
+    scanout_w = mode.hdisplay;
+    scanout_h = mode.vdisplay;
 
     // GBM device and surface
     gbm_dev = gbm_create_device(drm_fd);
@@ -304,12 +674,19 @@ void init_horrors(const char *device_path)
     gbm_surf = gbm_surface_create(gbm_dev,
                                   mode.hdisplay,
                                   mode.vdisplay,
-                                  GBM_FORMAT_XRGB8888,
+                                  options.rgb565 ? GBM_FORMAT_RGB565 : GBM_FORMAT_XRGB8888,
                                   GBM_BO_USE_SCANOUT | GBM_BO_USE_RENDERING);
     if (!gbm_surf) THROWF("gbm_surface_create failed");
 
     // EGL init
     init_egl();
+
+    // Atomic KMS if requested and available; page flips otherwise
+    if (options.present_mode == pmAtomic)
+    {
+        if (init_atomic()) init_native_fences();
+        else options.present_mode = pmFlip;
+    }
 }
 
 static bool card_has_active_connector(const char *card)
@@ -364,8 +741,300 @@ char *find_display_device()
     return nullptr;
 }
 
+// Scanout FB attached to a gbm_bo for the BO's whole lifetime
+struct BoFb
+{
+    int fd;
+    uint32_t fb_id;
+};
+
+static void destroy_bo_fb(gbm_bo *, void *data)
+{
+    BoFb *fb = (BoFb *)data;
+    if (fb->fb_id) drmModeRmFB(fb->fd, fb->fb_id);
+    delete fb;
+}
+
+// Returns the FB for a BO, creating it on first sight. gbm recycles a small set of BOs,
+// so after the first few frames no FBs are added or removed anymore.
+static uint32_t get_bo_fb(gbm_bo *bo)
+{
+    BoFb *fb = (BoFb *)gbm_bo_get_user_data(bo);
+    if (fb) return fb->fb_id;
+
+    uint32_t width = gbm_bo_get_width(bo);
+    uint32_t height = gbm_bo_get_height(bo);
+    uint32_t format = gbm_bo_get_format(bo);
+    uint32_t handles[4] = {gbm_bo_get_handle(bo).u32, 0, 0, 0};
+    uint32_t pitches[4] = {gbm_bo_get_stride(bo), 0, 0, 0};
+    uint32_t offsets[4] = {0, 0, 0, 0};
+
+    uint32_t new_fb_id = 0;
+    if (drmModeAddFB2(drm_fd, width, height, format, handles, pitches, offsets, &new_fb_id, 0))
+        THROWF_ERRNO("drmModeAddFB2 failed");
+
+    fb = new BoFb{drm_fd, new_fb_id};
+    gbm_bo_set_user_data(bo, fb, destroy_bo_fb);
+    return new_fb_id;
+}
+
+static void page_flip_handler(int, unsigned int sequence, unsigned int, unsigned int, void *)
+{
+    flip_sequence = sequence;
+    // Flip landed: the BO that was on screen until now can go back to the surface
+    if (bo) gbm_surface_release_buffer(gbm_surf, bo);
+    bo = pending_bo;
+    pending_bo = nullptr;
+}
+
+// Blocks until the queued page flip has completed, dispatching DRM events
+static void wait_for_flip()
+{
+    drmEventContext evctx;
+    memset(&evctx, 0, sizeof(evctx));
+    evctx.version = 2;
+    evctx.page_flip_handler = page_flip_handler;
+
+    pollfd pfd;
+    pfd.fd = drm_fd;
+    pfd.events = POLLIN;
+
+    while (pending_bo)
+    {
+        int ret = poll(&pfd, 1, 1000);
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            THROWF_ERRNO("poll on DRM device failed");
+        }
+        if (ret == 0)
+        {
+            // No vblank within a second (e.g. display off): stop flipping, modeset from now on.
+            // The flip may still be queued: both buffers stay locked until a modeset replaces them.
+            fprintf(stderr, "Page flip timed out. Falling back to legacy presentation.\n");
+            options.present_mode = pmLegacy;
+            drop_overlay_plane();
+            return;
+        }
+        drmHandleEvent(drm_fd, &evctx);
+    }
+}
+
+// Puts the overlay above the primary plane; false if zpos is fixed the wrong way round
+static bool setup_overlay_zpos()
+{
+    PlaneProps &op = kms_props.overlay;
+    if (!op.zpos) return true; // No zpos: overlays stack above the primary plane
+
+    uint64_t primary_z = 0, overlay_z = 0;
+    get_prop_id(primary_plane_id, DRM_MODE_OBJECT_PLANE, "zpos", &primary_z);
+    get_prop_id(overlay_plane_id, DRM_MODE_OBJECT_PLANE, "zpos", &overlay_z);
+
+    drmModePropertyPtr prop = drmModeGetProperty(drm_fd, op.zpos);
+    bool immutable = prop && (prop->flags & DRM_MODE_PROP_IMMUTABLE);
+    uint64_t max_z = (prop && prop->count_values >= 2) ? prop->values[1] : primary_z + 1;
+    drmModeFreeProperty(prop);
+
+    if (immutable)
+    {
+        op.zpos = 0;
+        return overlay_z > primary_z;
+    }
+    if (primary_z + 1 > max_z) return false;
+    overlay_zpos = primary_z + 1;
+    return true;
+}
+
+bool init_overlay_plane(int w, int h)
+{
+    if (use_sdl_window || !kms_scanout_enabled || options.present_mode != pmAtomic) return false;
+
+    overlay_plane_id = find_plane(DRM_PLANE_TYPE_OVERLAY, DRM_FORMAT_ARGB8888);
+    if (!overlay_plane_id || !get_plane_props(overlay_plane_id, kms_props.overlay) || !setup_overlay_zpos())
+    {
+        printf("No usable overlay plane; info overlay is blended on the GPU.\n");
+        overlay_plane_id = 0;
+        return false;
+    }
+
+    try
+    {
+        for (int i = 0; i < 2; ++i)
+            create_dumb_buffer(drm_fd, w, h, DRM_FORMAT_ARGB8888, overlay_bufs[i]);
+    }
+    catch (const igr_exception &e)
+    {
+        fprintf(stderr, "Overlay buffers unavailable (%s); info overlay is blended on the GPU.\n", e.what());
+        for (int i = 0; i < 2; ++i)
+            destroy_dumb_buffer(drm_fd, overlay_bufs[i]);
+        overlay_plane_id = 0;
+        return false;
+    }
+
+    printf("Using overlay plane %u for info overlay.\n", overlay_plane_id);
+    return true;
+}
+
+bool overlay_plane_active()
+{
+    return overlay_plane_id != 0 && !use_sdl_window && kms_scanout_enabled && options.present_mode == pmAtomic;
+}
+
+// Leaving atomic presentation: hide the plane if a commit showed it, and let the GPU blend the overlay
+static void drop_overlay_plane()
+{
+    if (!overlay_plane_id) return;
+    if (atomic_modeset_done) drmModeSetPlane(drm_fd, overlay_plane_id, crtc_id, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    printf("Info overlay is blended on the GPU from now on.\n");
+    overlay_plane_id = 0;
+}
+
+void upload_overlay(const uint8_t *rgba)
+{
+    if (!overlay_plane_id) return;
+
+    // Copied to the buffer that's not on screen by the next commit
+    const DumbBuffer &buf = overlay_bufs[0];
+    size_t n = (size_t)buf.width * buf.height;
+    overlay_staging.resize(n * 4);
+    const uint8_t *src = rgba;
+    uint8_t *dst = &overlay_staging[0];
+    for (size_t i = 0; i < n; ++i, src += 4, dst += 4)
+    {
+        // RGBA straight alpha => little-endian ARGB8888, premultiplied
+        uint32_t a = src[3];
+        dst[0] = (uint8_t)(src[2] * a / 255);
+        dst[1] = (uint8_t)(src[1] * a / 255);
+        dst[2] = (uint8_t)(src[0] * a / 255);
+        dst[3] = (uint8_t)a;
+    }
+    overlay_new_image = true;
+    overlay_dirty = true;
+}
+
+void show_overlay(bool visible, int x, int y)
+{
+    if (!overlay_plane_id) return;
+    if (visible == overlay_visible && x == overlay_x && y == overlay_y) return;
+    overlay_visible = visible;
+    overlay_x = x;
+    overlay_y = y;
+    overlay_dirty = true;
+}
+
+bool scanout_can_scale()
+{
+    return !use_sdl_window && kms_scanout_enabled && options.present_mode == pmAtomic && scanout_scaling;
+}
+
+void set_scanout_size(int w, int h)
+{
+    if (!scanout_can_scale()) return;
+    if (w == scanout_w && h == scanout_h) return;
+    scanout_w = w;
+    scanout_h = h;
+    scanout_dirty = true;
+}
+
+EGLContext create_shared_context()
+{
+    if (use_sdl_window || egl_ctx == EGL_NO_CONTEXT) return EGL_NO_CONTEXT;
+    // The config only has window surfaces: the other thread gets none
+    const char *exts = eglQueryString(egl_display, EGL_EXTENSIONS);
+    if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context")) return EGL_NO_CONTEXT;
+
+    EGLint ctx_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    EGLContext ctx = eglCreateContext(egl_display, egl_cfg, egl_ctx, ctx_attribs);
+    if (ctx == EGL_NO_CONTEXT) fprintf(stderr, "eglCreateContext for shared context failed: %d\n", eglGetError());
+    return ctx;
+}
+
+void destroy_shared_context(EGLContext ctx)
+{
+    if (ctx != EGL_NO_CONTEXT) eglDestroyContext(egl_display, ctx);
+}
+
+bool presentation_is_vsynced()
+{
+    if (use_sdl_window || !kms_scanout_enabled) return false;
+    return options.present_mode == pmFlip || options.present_mode == pmAtomic;
+}
+
+bool scanout_is_interlaced()
+{
+    if (use_sdl_window || !kms_scanout_enabled) return false;
+    return (mode.flags & DRM_MODE_FLAG_INTERLACE) != 0;
+}
+
+int next_scanout_field()
+{
+    // The frame lands on the vblank after the last completed flip, or after the one still pending.
+    // Which field an even sequence number is depends on the driver, hence --field-swap.
+    unsigned int seq;
+    if (presentation_is_vsynced()) seq = flip_sequence + 1 + (pending_bo ? 1 : 0);
+    else seq = ++unsynced_frames;
+    if (options.field_swap) ++seq;
+    return (int)(seq & 1);
+}
+
+// Atomic presentation; returns false if the caller should fall back to legacy paths
+static bool present_atomic(gbm_bo *new_bo, uint32_t new_fb_id, int fence_fd)
+{
+    // A non-blocking commit fails with EBUSY while the previous one is pending
+    if (atomic_modeset_done) wait_for_flip();
+    if (options.present_mode != pmAtomic)
+    {
+        // Previous commit never landed: wait_for_flip fell back to legacy presentation
+        if (fence_fd >= 0) close(fence_fd);
+        return false;
+    }
+
+    int ret = atomic_commit(new_fb_id, fence_fd);
+    if (ret && atomic_modeset_done && scanout_dirty)
+    {
+        // Driver rejected this source size after all: show full buffers, GPU upscales from now on
+        fprintf(stderr, "Plane scaling to %dx%d rejected; disabling.\n", scanout_w, scanout_h);
+        scanout_scaling = false;
+        scanout_w = mode.hdisplay;
+        scanout_h = mode.vdisplay;
+        ret = atomic_commit(new_fb_id, fence_fd);
+    }
+    if (fence_fd >= 0) close(fence_fd);
+    if (ret)
+    {
+        if (atomic_modeset_done)
+        {
+            fprintf(stderr, "Atomic commit failed (%d: %s). Falling back to page flips.\n", errno, strerror(errno));
+            crtc_reset_needed = true;
+        }
+        else fprintf(stderr, "Atomic modeset failed (%d: %s). Falling back to page flips.\n", errno, strerror(errno));
+        options.present_mode = pmFlip;
+        drop_overlay_plane();
+        return false;
+    }
+
+    if (!atomic_modeset_done)
+    {
+        // Blocking modeset: new buffer is on screen already
+        atomic_modeset_done = true;
+        test_plane_scaling(new_fb_id);
+        if (bo) gbm_surface_release_buffer(gbm_surf, bo);
+        bo = new_bo;
+    }
+    else pending_bo = new_bo;
+    return true;
+}
+
 void put_on_screen()
 {
+    // The kernel waits for rendering to finish before scanning a buffer out: explicitly with an in-fence,
+    // otherwise on the buffer's implicit fence. The CPU only keeps the GPU from falling too far behind.
+    int fence_fd = -1;
+    bool fenced = !use_sdl_window && kms_scanout_enabled &&
+                  options.present_mode == pmAtomic && egl_dup_native_fence_fd != nullptr;
+    if (fenced) fence_fd = create_render_fence();
+    pace_frame();
+
     if (use_sdl_window)
     {
 #if HAS_SDL2
@@ -388,21 +1057,22 @@ void put_on_screen()
     // Get new buffer
     gbm_bo *new_bo = gbm_surface_lock_front_buffer(gbm_surf);
     if (!new_bo) THROWF("gbm_surface_lock_front_buffer failed");
+    uint32_t new_fb_id = get_bo_fb(new_bo);
 
-    uint32_t width = gbm_bo_get_width(new_bo);
-    uint32_t height = gbm_bo_get_height(new_bo);
-    uint32_t stride = gbm_bo_get_stride(new_bo);
-    uint32_t handle = gbm_bo_get_handle(new_bo).u32;
-
-    uint32_t handles[4] = {handle, 0, 0, 0};
-    uint32_t pitches[4] = {stride, 0, 0, 0};
-    uint32_t offsets[4] = {0, 0, 0, 0};
+    if (options.present_mode == pmAtomic && present_atomic(new_bo, new_fb_id, fence_fd)) return;
 
-    uint32_t new_fb_id = 0;
-    if (drmModeAddFB2(drm_fd, width, height, GBM_FORMAT_XRGB8888,
-                      handles, pitches, offsets, &new_fb_id, 0))
+    // First frame always goes through a modeset; after that, flip on vblank if requested
+    if (options.present_mode == pmFlip && bo && !crtc_reset_needed)
     {
-        THROWF_ERRNO("drmModeAddFB2 failed");
+        // Only one flip can be queued: wait for the previous one to land
+        wait_for_flip();
+        if (options.present_mode == pmFlip)
+        {
+            if (drmModePageFlip(drm_fd, crtc_id, new_fb_id, DRM_MODE_PAGE_FLIP_EVENT, nullptr))
+                THROWF_ERRNO("drmModePageFlip failed");
+            pending_bo = new_bo;
+            return;
+        }
     }
 
     // Set new framebuffer before releasing old buffer
@@ -410,17 +1080,14 @@ void put_on_screen()
     {
         // Keep app running without direct KMS output.
         kms_scanout_enabled = false;
-        drmModeRmFB(drm_fd, new_fb_id);
         gbm_surface_release_buffer(gbm_surf, new_bo);
         return;
     }
 
-    // Now safe to release old buffer and remove old FB
+    crtc_reset_needed = false;
+    // Now safe to release old buffers, including one whose flip timed out
     if (bo) gbm_surface_release_buffer(gbm_surf, bo);
-    if (prev_fb_id) drmModeRmFB(drm_fd, prev_fb_id);
-
-    // Update for next iteration
+    if (pending_bo) gbm_surface_release_buffer(gbm_surf, pending_bo);
+    pending_bo = nullptr;
     bo = new_bo;
-    prev_fb_id = fb_id;
-    fb_id = new_fb_id;
 }
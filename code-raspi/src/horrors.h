@@ -2,6 +2,7 @@
 #define HORRORS_H
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <gbm.h>
 #include <xf86drm.h>
@@ -19,12 +20,37 @@ extern EGLDisplay egl_display;
 extern EGLContext egl_ctx;
 extern EGLSurface egl_surf;
 extern gbm_bo *bo;
-extern uint32_t fb_id, prev_fb_id;
+extern gbm_bo *pending_bo;
+extern uint32_t crtc_id;
 
 char *find_display_device();
 bool should_use_drm_backend();
+// Opens the device and picks connector, mode and CRTC; shared with the CPU output (cpu_output.h)
+void init_kms(const char *device_path);
+void cleanup_kms();
 void init_horrors(const char *device_path);
 void put_on_screen();
+bool presentation_is_vsynced();
+
+// Interlaced mode: each vblank scans out one field, i.e. every other row of the frame
+bool scanout_is_interlaced();
+// Field (0: rows 0, 2, ... from the top) that the frame being rendered now will be shown in
+int next_scanout_field();
+
+// Hardware upscaling: scan out only the bottom-left w x h of each frame, stretched to the full mode
+bool scanout_can_scale();
+void set_scanout_size(int w, int h);
+
+// Overlay plane: CPU-drawn RGBA8 image of the size passed to init, composited by the display controller
+bool init_overlay_plane(int w, int h);
+void upload_overlay(const uint8_t *rgba);
+void show_overlay(bool visible, int x, int y);
+// Whether the overlay plane is in use; it's dropped if presentation falls back from atomic commits
+bool overlay_plane_active();
+// Context sharing objects with egl_ctx, to be made current with no surface on another thread;
+// EGL_NO_CONTEXT if the backend or driver can't do that
+EGLContext create_shared_context();
+void destroy_shared_context(EGLContext ctx);
 void cleanup_horrors();
 
 #endif
@@ -0,0 +1,72 @@
+#include "info_overlay.h"
+
+// Local dependencies
+#include "horrors.h"
+#include "magic.h"
+#include "main.h"
+#include "render_blender.h"
+
+// Lib
+#include "lib/canvas_ity.h"
+
+// Global
+#include <cstdio>
+#include <cstdlib>
+
+// Band near the bottom of the screen, inside the CRT's overscan
+static const int ov_w = W;
+static const int ov_h = 112;
+static const int ov_x = 0;
+static const int ov_y = H - ov_h - 48;
+
+InfoOverlay::InfoOverlay(RenderBlender &renderer)
+    : renderer(renderer)
+    , pixels(ov_w * ov_h * 4)
+{
+    ctx = new canvas_ity::canvas(ov_w, ov_h);
+    size_t font_data_size;
+    uint8_t *font_data = load_canvas_font(&font_data_size);
+    ctx->set_font(font_data, font_data_size, 40);
+    free(font_data);
+
+    init_overlay_plane(ov_w, ov_h);
+}
+
+InfoOverlay::~InfoOverlay()
+{
+    delete ctx;
+}
+
+void InfoOverlay::draw(int freq, const char *name)
+{
+    char buf[64];
+
+    ctx->clear();
+    ctx->set_color(canvas_ity::fill_style, 0, 0, 0, 0.6f);
+    ctx->fill_rectangle(0, 0, ov_w, ov_h);
+
+    ctx->set_color(canvas_ity::fill_style, 0.95f, 0.65f, 0.15f, 1);
+    snprintf(buf, sizeof(buf), "%.1f MHz", freq * 0.1);
+    ctx->fill_text(buf, 80, 48);
+    ctx->set_color(canvas_ity::fill_style, 0.9f, 0.9f, 0.9f, 1);
+    ctx->fill_text(name, 80, 96);
+
+    ctx->get_image_data(&pixels[0], ov_w, ov_h, ov_w * 4, 0, 0);
+}
+
+void InfoOverlay::update(int station_ix, int freq, const char *name, bool visible)
+{
+    // Redraw and re-upload only when the station changes, or the plane was dropped
+    bool plane = overlay_plane_active();
+    if (station_ix != this->station_ix || plane != on_plane)
+    {
+        this->station_ix = station_ix;
+        on_plane = plane;
+        draw(freq, name);
+        if (on_plane) upload_overlay(&pixels[0]);
+        else renderer.set_overlay_image(&pixels[0], ov_x, ov_y, ov_w, ov_h);
+    }
+
+    if (on_plane) show_overlay(visible, ov_x, ov_y);
+    else renderer.set_overlay_visible(visible);
+}
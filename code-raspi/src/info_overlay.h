@@ -0,0 +1,35 @@
+#ifndef INFO_OVERLAY_H
+#define INFO_OVERLAY_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace canvas_ity
+{
+class canvas;
+}
+class RenderBlender;
+
+// Station info shown over the dimmed sketch near a station. It is drawn on the CPU only
+// when the station changes, and shown on a DRM overlay plane if there is one; otherwise
+// RenderBlender blends it in on the GPU.
+class InfoOverlay
+{
+  private:
+    RenderBlender &renderer;
+    canvas_ity::canvas *ctx = nullptr;
+    std::vector<uint8_t> pixels;
+    // Where the current image was uploaded: the overlay plane, or RenderBlender
+    bool on_plane = false;
+    int station_ix = -1;
+
+  private:
+    void draw(int freq, const char *name);
+
+  public:
+    InfoOverlay(RenderBlender &renderer);
+    ~InfoOverlay();
+    void update(int station_ix, int freq, const char *name, bool visible);
+};
+
+#endif
@@ -2,21 +2,22 @@
 
 // Local dependencies
 #include "arg_parse.h"
+#include "config.h"
+#include "cpu_output.h"
 #include "error.h"
 #include "file_helpers.h"
 #include "horrors.h"
 #include "magic.h"
+#include "options.h"
 
 // Global
 #include <csignal>
-#include <fcntl.h>
-#include <linux/fb.h>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
+#include <cstdlib>
 
 static const char *font_file_name = "IBMPlexMono-Regular.ttf";
 
 bool app_running = true;
+Options options;
 
 // clang-format off
 #define ACT_CALIBRATE   "action_calibrate"
@@ -38,10 +39,23 @@ int main(int argc, const char *argv[])
         signal(SIGINT, sighandler);
         signal(SIGTERM, sighandler);
 
+        load_config();
         if (!parse_args(argc, argv)) return -1;
 
-        if (action == ACT_CALIBRATE) calibrate_readings();
-        else if (action == ACT_TUNER) test_tuner();
+        if (action == ACT_CALIBRATE || action == ACT_TUNER)
+        {
+            // CPU-drawn modes: DRM if there is a device (e.g. --dev for VKMS), else fbdev
+            if (device_path.empty() && should_use_drm_backend())
+            {
+                const char *found_device = find_display_device();
+                if (found_device != nullptr) device_path.assign(found_device);
+                delete[] found_device;
+            }
+            init_cpu_output(device_path.c_str());
+            if (action == ACT_CALIBRATE) calibrate_readings();
+            else test_tuner();
+            cleanup_cpu_output();
+        }
         else if (action == ACT_RUN)
         {
             if (should_use_drm_backend())
@@ -70,18 +84,21 @@ int main(int argc, const char *argv[])
     catch (const igr_exception &e)
     {
         fprintf(stderr, "Runtime error in file %s line %d: %s:\n%s\n", e.file(), e.line(), e.func(), e.what());
+        cleanup_cpu_output();
         cleanup_horrors();
         return -1;
     }
     catch (const std::bad_alloc &e)
     {
         fprintf(stderr, "Out of memory: %s\n", e.what());
+        cleanup_cpu_output();
         cleanup_horrors();
         return -1;
     }
     catch (...)
     {
         fprintf(stderr, "Unexpected error\n");
+        cleanup_cpu_output();
         cleanup_horrors();
         return -1;
     }
@@ -100,6 +117,13 @@ static bool parse_args(int argc, const char *argv[])
     parser.add_argument(ACT_RUN, "run", "", "Action: Run normally with sketches");
     parser.add_argument("help", "--help", "", "Displays this help message");
     parser.add_argument("dev", "", "--dev", "Device path (default: /dev/dri/card0)", STORE);
+    parser.add_argument("present", "", "--present", "Presentation: atomic (default), flip or legacy", STORE);
+    parser.add_argument("rgb565", "", "--rgb565", "Use 16-bit RGB565 color throughout");
+    parser.add_argument("dither", "", "--dither", "Ordered dithering of final output (with --rgb565)");
+    parser.add_argument("field-swap", "", "--field-swap", "Swap field order of interlaced rendering");
+    parser.add_argument("bench", "", "--bench", "Print a performance report every few seconds");
+    parser.add_argument("frames-in-flight", "", "--frames-in-flight", "Frames in flight incl. the one being built, 1 to 3 (default: 2); 1 waits like glFinish", STORE);
+    parser.add_argument("sysfs-root", "", "--sysfs-root", "Read temperatures and CPU clocks from another tree (default: /sys)", STORE);
 
     bool success = parser.parse(argv, argc, stdout);
     if (!success || parser.get("help").is_set)
@@ -132,61 +156,42 @@ static bool parse_args(int argc, const char *argv[])
 
     if (parser.get("dev").is_set) device_path.assign(parser.get("dev").value.c_str());
 
-    if (!ok)
+    options.rgb565 = parser.get("rgb565").is_set;
+    options.dither = parser.get("dither").is_set;
+    options.bench = parser.get("bench").is_set;
+    options.field_swap = parser.get("field-swap").is_set;
+    if (parser.get("sysfs-root").is_set) options.sysfs_root = parser.get("sysfs-root").value;
+
+    if (parser.get("present").is_set)
     {
-        parser.print_usage(stdout);
-        return false;
+        std::string present = parser.get("present").value;
+        if (present == "atomic") options.present_mode = pmAtomic;
+        else if (present == "flip") options.present_mode = pmFlip;
+        else if (present == "legacy") options.present_mode = pmLegacy;
+        else
+        {
+            printf("\nBad arguments: Unknown presentation mode '%s'\n", present.c_str());
+            ok = false;
+        }
     }
-    else return true;
-}
 
-void flush_to_fb(float *image)
-{
-    int fb = open(FB_PATH, O_RDWR);
-    if (fb < 0)
-        THROWF_ERRNO("Failed to open '%s'", FB_PATH);
-
-    struct fb_var_screeninfo vinfo;
-    struct fb_fix_screeninfo finfo;
-    ioctl(fb, FBIOGET_FSCREENINFO, &finfo);
-    ioctl(fb, FBIOGET_VSCREENINFO, &vinfo);
-
-    // printf("Framebuffer size: %d x %d; bits per pixel: %d\n", vinfo.xres, vinfo.yres, vinfo.bits_per_pixel);
-
-    if (vinfo.xres != W || vinfo.yres != H)
-        THROWF("Framebuffer resolution (%d x %d) doesn't match image size of %d x %d", vinfo.xres, vinfo.yres, W, H);
-
-    if (vinfo.bits_per_pixel != 16)
-        THROWF("Expected 16 bits per pixel, got %d", vinfo.bits_per_pixel);
-
-    long screensize = vinfo.yres_virtual * finfo.line_length;
-    char *fbp = (char *)mmap(0, screensize, PROT_READ | PROT_WRITE, MAP_SHARED, fb, 0);
-    if (fbp == MAP_FAILED)
-        THROWF_ERRNO("Failed to map frame buffer to memory");
-
-    for (int y = 0; y < H; ++y)
+    if (parser.get("frames-in-flight").is_set)
     {
-        int vofs = y * W * 4;
-        for (int x = 0; x < W; ++x)
+        int n = atoi(parser.get("frames-in-flight").value.c_str());
+        if (n >= 1 && n <= 3) options.frames_in_flight = n;
+        else
         {
-            int ix = vofs + x * 4;
-            float rf = image[ix];
-            float gf = image[ix + 1];
-            float bf = image[ix + 2];
-            unsigned char r = static_cast<unsigned char>(rf * 31.0);
-            unsigned char g = static_cast<unsigned char>(gf * 63.0);
-            unsigned char b = static_cast<unsigned char>(bf * 31.0);
-            int fb_pos = (x + vinfo.xoffset) * (vinfo.bits_per_pixel / 8) +
-                         (y + vinfo.yoffset) * finfo.line_length;
-            unsigned short color = (r << 11) | (g << 5) | (b);
-            // color = 0xffff;
-            // color = 0;
-            *((unsigned short *)(fbp + fb_pos)) = color;
+            printf("\nBad arguments: --frames-in-flight must be 1, 2 or 3\n");
+            ok = false;
         }
     }
 
-    munmap(fbp, screensize);
-    close(fb);
+    if (!ok)
+    {
+        parser.print_usage(stdout);
+        return false;
+    }
+    else return true;
 }
 
 uint8_t *load_canvas_font(size_t *data_size)
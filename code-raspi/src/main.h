@@ -11,7 +11,6 @@ void calibrate_readings();
 void test_tuner();
 void main_igr();
 
-void flush_to_fb(float *image);
 uint8_t *load_canvas_font(size_t *data_size);
 
 #endif
@@ -1,6 +1,7 @@
 #include "main.h"
 
 // Local dependencies
+#include "cpu_output.h"
 #include "error.h"
 #include "file_helpers.h"
 #include "hardware_controller.h"
@@ -116,6 +117,6 @@ void calibrate_readings()
         ctx.fill_text(buf, 100, 428);
 
         ctx.get_image_data(image, W, H);
-        flush_to_fb(image);
+        show_cpu_image(image);
     }
 }
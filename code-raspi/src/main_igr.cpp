@@ -1,13 +1,24 @@
 #include "main.h"
 
 // Local dependencies
+#include "bench.h"
+#include "compile_worker.h"
 #include "error.h"
 #include "fps.h"
+#include "frame_pacer.h"
 #include "hardware_controller.h"
 #include "horrors.h"
+#include "info_overlay.h"
 #include "magic.h"
 #include "render_blender.h"
+#include "gl_state.h"
+#include "gpu_resources.h"
+#include "program_cache.h"
+#include "render_pass.h"
+#include "residency.h"
+#include "resolution_governor.h"
 #include "sketch_base.h"
+#include "thermal_monitor.h"
 #include "tuner.h"
 #include "tuning_feedback.h"
 
@@ -22,24 +33,89 @@
 // Global
 #include <vector>
 
+struct Station
+{
+    SketchBase *sketch;
+    int freq;
+    const char *name;
+    // Fraction of W x H the sketch renders at; the result is upscaled for display.
+    // The resolution governor lowers it further while frames run over budget.
+    float render_scale;
+    // On interlaced output, shade only the field being scanned out; off for fine vertical detail
+    bool interlaced;
+    // Renders one frame in this many when tuned in, for slowly evolving sketches; the frames between are
+    // interpolated by the blender. Where interlaced applies, i.e. full size on interlaced output, it wins and
+    // the divider is ignored: one field every frame costs the same on average without doubling peak frames.
+    int frame_divider;
+    // Shades half of the pixels per frame, in alternating checkerboard cells, where field rendering doesn't apply.
+    // Keeps the fine detail that scaling down would blur.
+    bool checkerboard;
+};
+
+// Under the info overlay the sketch is only faintly visible, so it draws one frame in this many
+static const int info_frame_interval = 3;
+
+// Resolution governor steps every station is kept down per ThermalLevel: none, to 75%, to 50% with medium shaders.
+// When hot, stations that shade all pixels every frame also render at 25 Hz at most.
+static const int thermal_min_steps[] = {0, 1, 3};
+
+// How far ahead the tuner's motion is extrapolated to pick the station to prefetch, in seconds
+static const double prefetch_lookahead = 0.5;
+// A prefetch is dropped once the tuner has predicted no station for this long, in seconds, so that an
+// overshot prediction can be evicted and counted as wasted
+static const double prefetch_hold = 2;
+
 static Tuner tuner(false);
-static std::vector<SketchBase *> sketches;
+static ResolutionGovernor governor(1.0 / TARGET_FPS);
+static std::vector<Station> stations;
 static int sketch_ix = -1;
+// The tuned station's sketch has been started; it is shown once loaded and started
+static bool sketch_started = false;
+// Station the knob is heading for; kept until the prediction changes to another one or the knob settles
+static int prefetch_ix = -1;
+// Last time the tuner predicted a station
+static double predicted_at = 0;
+// Time the started sketch hasn't been advanced by yet, because its frames were skipped
+static double sketch_dt = 0;
+static int info_frame_count = 0;
+
+static void init_stations(GLuint render_fbo, Residency &residency);
+static void update_station(TuningFeedback &tfb, RenderBlender &renderer, InfoOverlay &info, Residency &residency, double current_time);
 
-static void init_stations(GLuint render_fbo);
-static void update_station(TuningFeedback &tfb, RenderBlender &renderer, double current_time);
+// Whether the started sketch draws this frame: always when tuned in, never under static,
+// and one frame in info_frame_interval under the info overlay, starting with the first
+static bool schedule_sketch_frame(BlendMode mode)
+{
+    if (mode != bmInfo) info_frame_count = 0;
+    if (mode == bmSketch) return true;
+    if (mode != bmInfo) return false;
+    return info_frame_count++ % info_frame_interval == 0;
+}
 
 void main_igr()
 {
     RenderBlender renderer;
-    init_stations(renderer.fbo());
+    CompileWorker worker;
+    Residency residency(worker);
+    ThermalMonitor thermal;
+    init_stations(renderer.fbo(), residency);
 
     HardwareController::set_listeners(&tuner);
     HardwareController::init();
 
     TuningFeedback tfb;
+    InfoOverlay info(renderer);
 
-    FPS fps(TARGET_FPS);
+    // With vblank-synced page flips the display paces the loop
+    FPS fps(TARGET_FPS, !presentation_is_vsynced());
+    bench_register(report_pass_traffic);
+    bench_register(report_gl_state);
+    bench_register(report_gpu_resources);
+    bench_register(report_program_cache);
+    bench_register(Residency::report);
+    bench_register(report_frame_pacing);
+    bench_register(ResolutionGovernor::report);
+    bench_register(ThermalMonitor::report);
     double last_time = fps.frame_start();
 
     while (app_running)
@@ -48,13 +124,59 @@ void main_igr()
         double dt = current_time - last_time;
         last_time = current_time;
 
-        update_station(tfb, renderer, current_time);
-        if (sketch_ix == -1) continue;
+        update_station(tfb, renderer, info, residency, current_time);
 
-        sketches[sketch_ix]->frame(dt);
+        // Shed load before the SoC throttles itself: less detail is better than uneven frame pacing
+        ThermalLevel thermal_level = thermal.level();
+        governor.set_min_step(thermal_min_steps[thermal_level]);
+
+        // Static until the tuned station has loaded
+        SketchBase *sketch = sketch_started ? stations[sketch_ix].sketch : nullptr;
+        bool draw_sketch = false;
+        if (sketch)
+        {
+            sketch_dt += dt;
+            draw_sketch = schedule_sketch_frame(renderer.blend_mode());
+            sketch->set_render_scale(stations[sketch_ix].render_scale * governor.scale(sketch_ix));
+            sketch->set_quality(governor.quality(sketch_ix));
+            renderer.set_sketch_size(sketch->render_w(), sketch->render_h());
+            // A field left over from frames ago would comb under the info overlay
+            renderer.set_interlaced(stations[sketch_ix].interlaced && renderer.blend_mode() == bmSketch);
+            int divider = stations[sketch_ix].frame_divider;
+            // Not for checkerboarded or field-rendered stations, which already shade half a frame every frame:
+            // a full frame every other frame would save nothing and double every other frame's cost.
+            // The blender ignores the divider while fields apply.
+            if (thermal_level == tlHot && divider < 2 && !stations[sketch_ix].checkerboard) divider = 2;
+            renderer.set_frame_divider(divider);
+            renderer.set_checkerboard(stations[sketch_ix].checkerboard);
+        }
+        else
+        {
+            renderer.set_sketch_size(W, H);
+            renderer.set_interlaced(false);
+            renderer.set_frame_divider(1);
+            renderer.set_checkerboard(false);
+        }
+        GLuint target = renderer.sketch_target();
+        draw_sketch = draw_sketch && renderer.sketch_frame_due();
+        if (draw_sketch)
+        {
+            // Skipped frames' time is caught up in one step, so the sketch's clock stays on time
+            sketch->set_target(target);
+            sketch->set_field(renderer.sketch_field());
+            sketch->set_checker(renderer.sketch_checker());
+            sketch->frame(sketch_dt);
+            sketch_dt = 0;
+        }
         renderer.render(current_time);
+        renderer.capture_snapshot(sketch_ix);
         put_on_screen();
+        // Presentation may have fallen back to unpaced modesets
+        fps.set_throttle(!presentation_is_vsynced());
         fps.frame_end();
+        // Only frames the sketch drew while tuned in tell whether it keeps up
+        if (draw_sketch && renderer.blend_mode() == bmSketch) governor.frame(sketch_ix, fps.last_frame_sec(), current_time);
+        bench_frame_end(current_time);
 
         int tuner, aknob, bknob, cknob, swtch;
         HardwareController::get_values(tuner, aknob, bknob, cknob, swtch);
@@ -64,25 +186,28 @@ void main_igr()
 }
 
 template <typename T>
-void add_station(GLuint render_fbo, int freq)
+void add_station(GLuint render_fbo, Residency &residency, int freq, const char *name, float render_scale = 1,
+                 bool interlaced = false, int frame_divider = 1, bool checkerboard = false)
 {
+    // Loaded when tuned in or about to be
     auto sketch = new T(W, H, render_fbo);
-    sketch->init();
+    residency.add(sketch);
     tuner.add_station(freq);
-    sketches.push_back(sketch);
+    governor.add(sketch->has_quality_variants());
+    stations.push_back({sketch, freq, name, render_scale, interlaced, frame_divider, checkerboard});
 }
 
-void init_stations(GLuint render_fbo)
+void init_stations(GLuint render_fbo, Residency &residency)
 {
-    add_station<StarSketch>(render_fbo, 980);
-    add_station<MMGL01Sketch>(render_fbo, 967);
-    add_station<RaySketch>(render_fbo, 953);
-    add_station<CellSketch>(render_fbo, 941);
-    add_station<BezixSketch>(render_fbo, 932);
-    add_station<AnomalySketch>(render_fbo, 920);
+    add_station<StarSketch>(render_fbo, residency, 980, "Star", 1, true, 1, true);
+    add_station<MMGL01Sketch>(render_fbo, residency, 967, "MMGL01", 1, true);
+    add_station<RaySketch>(render_fbo, residency, 953, "Ray", 0.5);
+    add_station<CellSketch>(render_fbo, residency, 941, "Cell", 1, false, 2);
+    add_station<BezixSketch>(render_fbo, residency, 932, "Bezix", 1, true, 1, true);
+    add_station<AnomalySketch>(render_fbo, residency, 920, "Anomaly", 1, true, 2);
 }
 
-void update_station(TuningFeedback &tfb, RenderBlender &renderer, double current_time)
+void update_station(TuningFeedback &tfb, RenderBlender &renderer, InfoOverlay &info, Residency &residency, double current_time)
 {
     int station_ix;
     TuneStatus tuner_status;
@@ -96,16 +221,41 @@ void update_station(TuningFeedback &tfb, RenderBlender &renderer, double current
 
     if (station_ix < -1) return;
 
-    if (station_ix != sketch_ix && sketch_ix != -1)
+    if (station_ix != sketch_ix) sketch_started = false;
+    sketch_ix = station_ix;
+    if (sketch_ix != -1) residency.use(sketch_ix, current_time);
+
+    // Start loading the station the knob is heading for, so that it's warm when the listener gets there
+    int predicted_ix = tuner.predict_station(prefetch_lookahead);
+    if (predicted_ix != -1)
     {
-        sketches[sketch_ix]->unload(current_time);
-        sketches[station_ix]->reload(current_time);
+        prefetch_ix = predicted_ix;
+        predicted_at = current_time;
     }
-    sketch_ix = station_ix;
+    // Settled somewhere else, or no longer heading anywhere: the prediction overshot
+    else if (tuner_status == tsTuned || current_time - predicted_at >= prefetch_hold)
+        prefetch_ix = -1;
+    if (prefetch_ix == sketch_ix) prefetch_ix = -1;
+    if (prefetch_ix != -1) residency.prefetch(prefetch_ix, current_time);
+    residency.poll(current_time);
 
-    if (tuner_status == tsTuned)
+    // Restart the clock each time it's tuned in
+    if (sketch_ix != -1 && !sketch_started && residency.loaded(sketch_ix))
+    {
+        stations[sketch_ix].sketch->start(current_time);
+        sketch_started = true;
+        sketch_dt = 0;
+    }
+
+    // Until the sketch's first frame, its last snapshot under static if there is one
+    if (!sketch_started) renderer.set_mode(sketch_ix != -1 && renderer.set_snapshot(sketch_ix) ? bmSnapshot : bmStatic);
+    else if (tuner_status == tsTuned)
         renderer.set_mode(bmSketch);
     else if (tuner_status == tsAbove || tuner_status == tsBelow)
         renderer.set_mode(bmInfo);
     else renderer.set_mode(bmStatic);
+
+    if (sketch_ix == -1) return;
+    const Station &station = stations[sketch_ix];
+    info.update(sketch_ix, station.freq, station.name, tuner_status == tsAbove || tuner_status == tsBelow);
 }
@@ -1,10 +1,12 @@
 #include "main.h"
 
 // Local dependencies
+#include "cpu_output.h"
 #include "error.h"
 #include "file_helpers.h"
 #include "hardware_controller.h"
 #include "magic.h"
+#include "options.h"
 #include "tuner.h"
 #include "tuning_feedback.h"
 
@@ -50,10 +52,11 @@ void test_tuner()
         sprintf(buf, "Freq  %5.1f", freq);
         ctx.fill_text(buf, 100, 164);
 
-        const int vm = 4, hm = 46;
+        // Overscan: visible_rect in igr.conf should end up right at the edges of the screen
+        const int *vr = options.visible_rect;
         ctx.set_line_width(2.0f);
         ctx.set_color(canvas_ity::stroke_style, 1, 0.3, 0.3, 1);
-        ctx.stroke_rectangle(hm, vm, W - 2 * hm, H - 2 * vm);
+        ctx.stroke_rectangle(vr[0], vr[1], vr[2], vr[3]);
 
         int station_ix;
         TuneStatus tuner_status;
@@ -82,6 +85,6 @@ void test_tuner()
         }
 
         ctx.get_image_data(image, W, H);
-        flush_to_fb(image);
+        show_cpu_image(image);
     }
 }
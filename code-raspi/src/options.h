@@ -0,0 +1,42 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "magic.h"
+
+#include <stddef.h>
+#include <string>
+
+enum PresentMode
+{
+    pmLegacy, // drmModeSetCrtc on every frame
+    pmFlip,   // drmModePageFlip on vblank
+    pmAtomic, // Non-blocking atomic commits with GPU in-fences
+};
+
+// Runtime options; set from the command line in main.cpp and from igr.conf (config.h)
+struct Options
+{
+    PresentMode present_mode = pmAtomic;
+    // 16-bit color for scanout, EGL surface and render targets; composite PAL can't show more
+    bool rgb565 = false;
+    // Ordered dithering in RenderBlender's final pass, for rgb565
+    bool dither = false;
+    // Interlaced field rendering: swap which field is assumed to be scanned out next
+    bool field_swap = false;
+    // Part of the W x H frame that the CRT shows (x, y, w, h from the top left); nothing else is shaded
+    int visible_rect[4] = {0, 0, W, H};
+    // Print a performance report every few seconds
+    bool bench = false;
+    // Frames in flight, counting the one the CPU builds (1-3); more overlap, at up to one frame of latency each
+    int frames_in_flight = 2;
+    // Directory for linked shader program binaries, relative to the binary's unless absolute; empty: no cache
+    std::string shader_cache = "shader-cache";
+    // GPU memory that loaded sketches may keep, in bytes; least recently used ones are unloaded beyond it
+    size_t gpu_budget = 32 << 20;
+    // Where the thermal monitor finds class/thermal and devices/system/cpu; another tree can stand in for tests
+    std::string sysfs_root = "/sys";
+};
+
+extern Options options;
+
+#endif
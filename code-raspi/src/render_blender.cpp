@@ -4,77 +4,313 @@
 #include "error.h"
 #include "horrors.h"
 #include "magic.h"
+#include "options.h"
+#include "sketches/gl_state.h"
+#include "sketches/gpu_resources.h"
+#include "sketches/render_pass.h"
 #include "sketches/shaders.h"
 #include "sketches/sketch_base.h"
 
 // Global
+#include <GLES3/gl3.h>
+#include <utility>
+
+// Snapshot pool: bounded at snapshot_slots * 360 * 288 * 2 bytes
+static const int snapshot_slots = 8;
+static const int snapshot_w = W / 2;
+static const int snapshot_h = H / 2;
+// Frames between captures while a station is shown; the first fresh frame is always captured
+static const int snapshot_interval = 25;
 
 RenderBlender::RenderBlender()
+    : sketch_w(W)
+    , sketch_h(H)
 {
-    SketchBase::create_target_texture(W, H, render_tex, render_fbo, render_depth);
+    create_render_target(render_tex, render_fbo);
     compile_render_prog();
 }
 
-void RenderBlender::render(double time)
+void RenderBlender::create_render_target(GLuint &tex, GLuint &fbo)
+{
+    SketchBase::create_target_texture(W, H, tex, fbo);
+    // Linear so that GPU upscaling of scaled-down sketches isn't blocky; exact at 1:1
+    gl_bind_texture_for_edit(0, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (stencil_rb != 0) attach_stencil(fbo);
+}
+
+void RenderBlender::attach_stencil(GLuint fbo)
 {
-    glUseProgram(render_prog);
+    gl_bind_framebuffer(fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencil_rb);
+}
+
+GLuint RenderBlender::sketch_target()
+{
+    // Interlaced: the sketch updates one field of render_fbo per frame, so render_fbo holds the
+    // weave of the last two frames; only full-size sketches line up with the scanout's rows.
+    // Takes precedence over a divider: it halves every frame's cost, where a divider doubles every other one's.
+    bool fields = interlaced && scanout_is_interlaced() && sketch_w == W && sketch_h == H;
+
+    // Reduced frame rate: every divider frames the sketch renders into the older target, which becomes the newest.
+    // History isn't kept up unless tuned in; a new run renders its first frame right away.
+    bool interpolating = mode == bmSketch && frame_divider > 1 && !fields;
+    if (!interpolating) history_frames = 0;
+    sketch_due = !interpolating || history_frames == 0 || ++divider_phase >= frame_divider;
+    if (interpolating && sketch_due)
+    {
+        if (prev_fbo == 0) create_render_target(prev_tex, prev_fbo);
+        std::swap(render_tex, prev_tex);
+        std::swap(render_fbo, prev_fbo);
+        prev_w = newest_w;
+        prev_h = newest_h;
+        newest_w = sketch_w;
+        newest_h = sketch_h;
+        if (history_frames < 2) ++history_frames;
+        divider_phase = 0;
+    }
+
+    field = fields ? next_scanout_field() : -1;
+
+    // Checkerboard: the other half of the cells is the frame before, so a new run or size starts with a full frame
+    bool checkering = checkerboard && mode == bmSketch && !interpolating && field < 0;
+    int last_checker = checker;
+    checker = -1;
+    if (!checkering) checker_w = checker_h = 0;
+    else if (sketch_w == checker_w && sketch_h == checker_h) checker = last_checker == 0 ? 1 : 0;
+    else
+    {
+        checker_w = sketch_w;
+        checker_h = sketch_h;
+    }
+    if (checker >= 0 && stencil_rb == 0)
+    {
+        glGenRenderbuffers(1, &stencil_rb);
+        glBindRenderbuffer(GL_RENDERBUFFER, stencil_rb);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, W, H);
+        attach_stencil(render_fbo);
+        if (prev_fbo != 0) attach_stencil(prev_fbo);
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, render_vbo);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    // Fully tuned, the blend pass is an exact copy of render_tex: let the sketch draw the back buffer.
+    // Not when the copy does more than that: overlay, dithering, or upscaling that scanout can't do.
+    bool scaled = sketch_w != W || sketch_h != H;
+    pass_through = mode == bmSketch
+                   && !interpolating
+                   && !checkering
+                   && field < 0
+                   && !(overlay_visible && overlay_tex != 0)
+                   && !(options.rgb565 && options.dither)
+                   && (!scaled || scanout_can_scale());
+    return pass_through ? 0 : render_fbo;
+}
+
+void RenderBlender::render(double time)
+{
+    if (pass_through)
+    {
+        set_scanout_size(sketch_w, sketch_h);
+        return;
+    }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, render_tex);
+    render_prog.use();
+    gl_bind_vertex_array(quad_vao());
+    gl_bind_texture(0, render_tex);
 
-    GLint tex_loc = glGetUniformLocation(render_prog, "tex");
-    GLint resolution_loc = glGetUniformLocation(render_prog, "resolution");
-    GLint time_loc = glGetUniformLocation(render_prog, "time");
-    GLint sketch_strength_loc = glGetUniformLocation(render_prog, "sketchStrength");
+    // Scaled-down sketch: let the display controller upscale if it can, else stretch it here.
+    // Static and snapshots are always rendered at full size.
+    int out_w = W, out_h = H;
+    if ((mode == bmSketch || mode == bmInfo) && scanout_can_scale())
+    {
+        out_w = sketch_w;
+        out_h = sketch_h;
+    }
+    set_scanout_size(out_w, out_h);
 
-    glUniform1i(tex_loc, 0);
-    glUniform2f(resolution_loc, (float)W, (float)H);
-    glUniform1f(time_loc, (float)time);
+    render_prog.set(tex_uni, 0);
+    render_prog.set(resolution_uni, (float)out_w, (float)out_h);
+    render_prog.set(time_uni, (float)time);
 
     float sketchStrength = 0; // static
-    if (mode == bmInfo) sketchStrength = 0.2;
+    if (mode == bmInfo) sketchStrength = 0.2f;
     else if (mode == bmSketch) sketchStrength = 1;
-    glUniform1f(sketch_strength_loc, (float)sketchStrength);
+    if (mode == bmSnapshot && snapshot_ix >= 0)
+    {
+        Snapshot &snap = snapshots[snapshot_ix];
+        snap.last_used = frame_count;
+        gl_bind_texture(0, snap.tex);
+        render_prog.set(tex_scale_uni, 1.0f, 1.0f);
+        sketchStrength = 0.7f;
+        render_prog.set(static_mix_uni, 1.0f);
+        render_prog.set(prev_mix_uni, 0.0f);
+    }
+    else if (mode == bmSketch && frame_divider > 1)
+    {
+        // Fade from the previous sketch frame to the newest, reaching it just before the next one is due
+        float prev_mix = history_frames < 2 ? 0.0f : 1.0f - (float)(divider_phase + 1) / frame_divider;
+        render_prog.set(tex_scale_uni, (float)newest_w / W, (float)newest_h / H);
+        render_prog.set(prev_mix_uni, prev_mix);
+        if (prev_mix > 0)
+        {
+            gl_bind_texture(2, prev_tex);
+            render_prog.set(prev_tex_uni, 2);
+            render_prog.set(prev_tex_scale_uni, (float)prev_w / W, (float)prev_h / H);
+        }
+        render_prog.set(static_mix_uni, 0.0f);
+    }
+    else
+    {
+        render_prog.set(tex_scale_uni, (float)sketch_w / W, (float)sketch_h / H);
+        render_prog.set(static_mix_uni, 0.0f);
+        render_prog.set(prev_mix_uni, 0.0f);
+    }
+    render_prog.set(sketch_strength_uni, sketchStrength);
+    render_prog.set(checker_phase_uni, (float)checker);
+    render_prog.set(dither_uni, options.rgb565 && options.dither ? 1.0f : 0.0f);
+
+    // Info overlay, unless the display controller composites it on its own plane
+    bool overlay_on = mode == bmInfo && overlay_visible && overlay_tex != 0;
+    render_prog.set(overlay_on_uni, overlay_on ? 1.0f : 0.0f);
+    if (overlay_on)
+    {
+        gl_bind_texture(1, overlay_tex);
+        render_prog.set(overlay_tex_uni, 1);
+        float sx = (float)out_w / W, sy = (float)out_h / H;
+        render_prog.set(overlay_rect_uni, overlay_rect[0] * sx, overlay_rect[1] * sy, overlay_rect[2] * sx, overlay_rect[3] * sy);
+    }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, W, H);
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Every output pixel is written with alpha 1: no need to load or clear the back buffer.
+    // Always all rows, also for a single sketch field: back buffers rotate, so the other rows would be stale.
+    RenderPass pass = {0, out_w, out_h, loDontCare, soStore, true, false};
+    begin_pass(pass);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glFinish();
+    end_pass(pass);
 }
 
 void RenderBlender::compile_render_prog()
 {
-    // Compile shaders
-    auto vs = SketchBase::compile_shader(GL_VERTEX_SHADER, sweep_vert);
-    auto fs = SketchBase::compile_shader(GL_FRAGMENT_SHADER, render_frag);
+    render_prog.build(sweep_vert, render_frag);
+    tex_uni = render_prog.uniform("tex");
+    resolution_uni = render_prog.uniform("resolution");
+    time_uni = render_prog.uniform("time");
+    sketch_strength_uni = render_prog.uniform("sketchStrength");
+    tex_scale_uni = render_prog.uniform("texScale");
+    dither_uni = render_prog.uniform("dither");
+    overlay_on_uni = render_prog.uniform("overlayOn");
+    overlay_tex_uni = render_prog.uniform("overlayTex");
+    overlay_rect_uni = render_prog.uniform("overlayRect");
+    static_mix_uni = render_prog.uniform("staticMix");
+    prev_tex_uni = render_prog.uniform("prevTex");
+    prev_tex_scale_uni = render_prog.uniform("prevTexScale");
+    prev_mix_uni = render_prog.uniform("prevMix");
+    checker_phase_uni = render_prog.uniform("checkerPhase");
+}
 
-    // Link program, with position attribute
-    render_prog = glCreateProgram();
-    glAttachShader(render_prog, vs);
-    glAttachShader(render_prog, fs);
-    const GLint ixPosAttribute = 0;
-    glBindAttribLocation(render_prog, ixPosAttribute, "position");
-    glLinkProgram(render_prog);
-    GLint ok = 0;
-    glGetProgramiv(render_prog, GL_LINK_STATUS, &ok);
-    if (!ok) SketchBase::throw_shader_link_error(render_prog);
+RenderBlender::Snapshot *RenderBlender::find_snapshot(int key)
+{
+    for (auto &snap : snapshots)
+        if (snap.key == key) return &snap;
+    return nullptr;
+}
 
-    // Array buffer: for vertex array
-    std::vector<GLfloat> quad;
-    SketchBase::fill_quad(quad);
+void RenderBlender::capture_snapshot(int key)
+{
+    ++frame_count;
+    if (mode != bmSketch) return;
+    if (key == capture_key && frame_count - capture_frame < snapshot_interval) return;
+    capture_key = key;
+    capture_frame = frame_count;
 
-    glGenBuffers(1, &render_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, render_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * quad.size(), &quad[0], GL_STATIC_DRAW);
+    // The station's own slot, else a new one while the pool has room, else the least recently used
+    Snapshot *snap = find_snapshot(key);
+    if (!snap && (int)snapshots.size() < snapshot_slots)
+    {
+        Snapshot s = {key, 0, 0, 0};
+        glGenTextures(1, &s.tex);
+        gl_bind_texture_for_edit(0, s.tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, snapshot_w, snapshot_h, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenFramebuffers(1, &s.fbo);
+        gl_bind_framebuffer(s.fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s.tex, 0);
+        snapshots.push_back(s);
+        snap = &snapshots.back();
+    }
+    if (!snap)
+    {
+        snap = &snapshots[0];
+        for (auto &s : snapshots)
+            if (s.last_used < snap->last_used) snap = &s;
+    }
+    snap->key = key;
+    snap->last_used = frame_count;
+
+    // Downscaling blit from wherever the sketch's output is: the back buffer in pass-through
+    gl_bind_framebuffer(snap->fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, pass_through ? 0 : render_fbo);
+    gl_set_enabled(GL_SCISSOR_TEST, false);
+    glBlitFramebuffer(0, 0, sketch_w, sketch_h, 0, 0, snapshot_w, snapshot_h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    // Back to what the state cache has bound
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, snap->fbo);
+}
+
+bool RenderBlender::set_snapshot(int key)
+{
+    Snapshot *snap = find_snapshot(key);
+    snapshot_ix = snap ? (int)(snap - &snapshots[0]) : -1;
+    return snap != nullptr;
 }
 
 void RenderBlender::set_mode(BlendMode mode)
 {
     this->mode = mode;
 }
+
+void RenderBlender::set_interlaced(bool interlaced)
+{
+    this->interlaced = interlaced;
+}
+
+void RenderBlender::set_frame_divider(int divider)
+{
+    frame_divider = divider < 1 ? 1 : divider;
+}
+
+void RenderBlender::set_checkerboard(bool checkerboard)
+{
+    this->checkerboard = checkerboard;
+}
+
+void RenderBlender::set_sketch_size(int w, int h)
+{
+    sketch_w = w;
+    sketch_h = h;
+}
+
+void RenderBlender::set_overlay_image(const uint8_t *rgba, int x, int y, int w, int h)
+{
+    if (overlay_tex == 0)
+    {
+        glGenTextures(1, &overlay_tex);
+        gl_bind_texture_for_edit(1, overlay_tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else gl_bind_texture_for_edit(1, overlay_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+    // Shader works in GL window coordinates, which start at the bottom
+    overlay_rect[0] = (float)x;
+    overlay_rect[1] = (float)(H - y - h);
+    overlay_rect[2] = (float)w;
+    overlay_rect[3] = (float)h;
+}
+
+void RenderBlender::set_overlay_visible(bool visible)
+{
+    overlay_visible = visible;
+}
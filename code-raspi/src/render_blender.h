@@ -1,33 +1,124 @@
 #ifndef RENDER_BLENDER_H
 #define RENDER_BLENDER_H
 
+#include "sketches/shader_program.h"
+
 #include <GLES2/gl2.h>
+#include <stdint.h>
+#include <vector>
 
 enum BlendMode
 {
     bmStatic,
     bmInfo,
     bmSketch,
+    // Station's last snapshot under static, while its sketch loads
+    bmSnapshot,
 };
 
 class RenderBlender
 {
   private:
+    // Half-size RGB565 copy of a station's recent output
+    struct Snapshot
+    {
+        int key;
+        GLuint tex;
+        GLuint fbo;
+        // Frame counter value when last captured or shown, for recycling the least recently used
+        long last_used;
+    };
+
+    // Holds the sketch's newest frame
     GLuint render_tex = 0;
-    GLuint render_depth = 0;
     GLuint render_fbo = 0;
-    GLuint render_prog = 0;
-    GLuint render_vbo = 0;
+    // The frame before, for stations rendering at a fraction of the frame rate; swapped with render_* per sketch frame
+    GLuint prev_tex = 0;
+    GLuint prev_fbo = 0;
+    // Attached to both targets once a station renders checkerboards; its contents never outlive a pass
+    GLuint stencil_rb = 0;
+    ShaderProgram render_prog;
+    ShaderProgram::Uniform tex_uni;
+    ShaderProgram::Uniform resolution_uni;
+    ShaderProgram::Uniform time_uni;
+    ShaderProgram::Uniform sketch_strength_uni;
+    ShaderProgram::Uniform tex_scale_uni;
+    ShaderProgram::Uniform dither_uni;
+    ShaderProgram::Uniform overlay_on_uni;
+    ShaderProgram::Uniform overlay_tex_uni;
+    ShaderProgram::Uniform overlay_rect_uni;
+    ShaderProgram::Uniform static_mix_uni;
+    ShaderProgram::Uniform prev_tex_uni;
+    ShaderProgram::Uniform prev_tex_scale_uni;
+    ShaderProgram::Uniform prev_mix_uni;
+    ShaderProgram::Uniform checker_phase_uni;
+    GLuint overlay_tex = 0;
+    float overlay_rect[4] = {0, 0, 0, 0};
+    bool overlay_visible = false;
+    int sketch_w, sketch_h;
     BlendMode mode = bmStatic;
+    bool pass_through = false;
+    bool interlaced = false;
+    int field = -1;
+    int frame_divider = 1;
+    // While interpolating: frames since the sketch's last frame, how many of the two targets hold frames
+    // of this run, and the sizes they were rendered at
+    int divider_phase = 0;
+    int history_frames = 0;
+    int newest_w = 0, newest_h = 0;
+    int prev_w = 0, prev_h = 0;
+    bool sketch_due = true;
+    bool checkerboard = false;
+    int checker = -1;
+    // Size of the last full or checkerboard frame in render_fbo while checkerboarding, else 0
+    int checker_w = 0, checker_h = 0;
+    std::vector<Snapshot> snapshots;
+    int snapshot_ix = -1;
+    int capture_key = -1;
+    long frame_count = 0;
+    long capture_frame = 0;
 
   private:
     void compile_render_prog();
+    void create_render_target(GLuint &tex, GLuint &fbo);
+    void attach_stencil(GLuint fbo);
+    Snapshot *find_snapshot(int key);
 
   public:
     RenderBlender();
     GLuint fbo() const { return render_fbo; }
     void set_mode(BlendMode mode);
+    BlendMode blend_mode() const { return mode; }
+    // Size of the area the sketch rendered into, at the bottom left of the render target
+    void set_sketch_size(int w, int h);
+    // GPU fallback for the info overlay when there is no overlay plane; y is from the top
+    void set_overlay_image(const uint8_t *rgba, int x, int y, int w, int h);
+    void set_overlay_visible(bool visible);
+    // Station opts in to shading only the field that is scanned out next, on interlaced modes
+    void set_interlaced(bool interlaced);
+    // Station renders one frame in divider when tuned in; the blender fades from its previous frame to the newest
+    // over the frames in between, showing it one sketch frame late. 1 renders every frame.
+    // Ignored while the station shades single fields.
+    void set_frame_divider(int divider);
+    // Station opts in to shading half of the frame in alternating checkerboard cells when tuned in;
+    // the blender fills in the other half from the frame before
+    void set_checkerboard(bool checkerboard);
+    // Decides this frame's pass-through and field, and returns the FBO the sketch must render into.
+    // Call after set_mode, set_sketch_size and set_interlaced, before the sketch's frame.
+    GLuint sketch_target();
+    // Field the sketch's final pass should shade this frame, or -1 for all rows
+    int sketch_field() const { return field; }
+    // Checkerboard phase the sketch's final pass should shade this frame, or -1 for all cells
+    int sketch_checker() const { return checker; }
+    // Whether the sketch is to render this frame, as decided by sketch_target for a frame divider
+    bool sketch_frame_due() const { return sketch_due; }
     void render(double time);
+
+    // Per-station snapshots, to show for the moment between tuning in and the sketch's first frame.
+    // After render: in bmSketch, now and then copies the frame just rendered as key's snapshot.
+    void capture_snapshot(int key);
+    // Picks key's snapshot for bmSnapshot; false if there is none
+    bool set_snapshot(int key);
 };
 
 #endif
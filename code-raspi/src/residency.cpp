@@ -0,0 +1,108 @@
+#include "residency.h"
+
+// Local dependencies
+#include "bench.h"
+#include "compile_worker.h"
+#include "options.h"
+#include "sketches/sketch_base.h"
+
+// Statistics for the bench report, since start
+static size_t resident_bytes = 0;
+static int evictions = 0;
+static int prefetch_loads = 0;
+static int prefetch_warm = 0;
+static int prefetch_late = 0;
+static int prefetch_wasted = 0;
+
+Residency::Residency(CompileWorker &worker)
+    : worker(worker)
+{
+}
+
+int Residency::add(SketchBase *sketch)
+{
+    entries.push_back({sketch, lsUnloaded, -1, 0, false});
+    return (int)entries.size() - 1;
+}
+
+void Residency::load(int ix, double time)
+{
+    Entry &e = entries[ix];
+    if (e.state != lsUnloaded) return;
+    // Size is known from an earlier load; the first time, room is made once the load is done
+    make_room(e.bytes, time);
+    worker.queue_init(e.sketch);
+    e.state = lsLoading;
+}
+
+void Residency::evict(int ix, double time)
+{
+    Entry &e = entries[ix];
+    e.sketch->unload(time);
+    e.state = lsUnloaded;
+    resident_bytes -= e.bytes;
+    ++evictions;
+    if (e.prefetched) ++prefetch_wasted;
+    e.prefetched = false;
+}
+
+void Residency::make_room(size_t bytes, double time)
+{
+    while (resident_bytes + bytes > options.gpu_budget)
+    {
+        int lru = -1;
+        for (int i = 0; i < (int)entries.size(); ++i)
+        {
+            const Entry &e = entries[i];
+            if (e.state != lsLoaded || e.last_used >= time) continue;
+            if (lru == -1 || e.last_used < entries[lru].last_used) lru = i;
+        }
+        // Everything resident is in use: go over budget rather than show static
+        if (lru == -1) return;
+        evict(lru, time);
+    }
+}
+
+void Residency::use(int ix, double time)
+{
+    Entry &e = entries[ix];
+    e.last_used = time;
+    if (e.prefetched)
+    {
+        if (e.state == lsLoaded) ++prefetch_warm;
+        else ++prefetch_late;
+        e.prefetched = false;
+    }
+    load(ix, time);
+}
+
+void Residency::prefetch(int ix, double time)
+{
+    Entry &e = entries[ix];
+    e.last_used = time;
+    if (e.state != lsUnloaded) return;
+    load(ix, time);
+    e.prefetched = true;
+    ++prefetch_loads;
+}
+
+void Residency::poll(double time)
+{
+    for (auto &e : entries)
+    {
+        if (e.state != lsLoading || !worker.init_done(e.sketch)) continue;
+        e.state = lsLoaded;
+        e.bytes = e.sketch->gpu_bytes();
+        resident_bytes += e.bytes;
+    }
+    make_room(0, time);
+}
+
+void Residency::report(std::string &out, int frames)
+{
+    const double mb = 1024 * 1024;
+    bench_appendf(out, "  Resident sketches: %.1f of %.1f MB; since start %d evictions\n",
+                  resident_bytes / mb, options.gpu_budget / mb, evictions);
+    bench_appendf(out, "  Prefetch since start: %d loads; tuned in %d warm, %d still loading; %d evicted unused\n",
+                  prefetch_loads, prefetch_warm, prefetch_late, prefetch_wasted);
+}
@@ -0,0 +1,59 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class CompileWorker;
+class SketchBase;
+
+// Decides which stations' sketches are loaded. Recently used ones stay loaded as long as their GPU memory
+// fits options.gpu_budget; to make room, the least recently used one is unloaded. Loads run on the compile worker.
+// Render thread only.
+class Residency
+{
+  private:
+    enum LoadState
+    {
+        lsUnloaded,
+        lsLoading, // init queued or running on the compile worker
+        lsLoaded,
+    };
+    struct Entry
+    {
+        SketchBase *sketch;
+        LoadState state;
+        // Time of the last use() or prefetch()
+        double last_used;
+        // Measured when the sketch last finished loading; 0 before its first load
+        size_t bytes;
+        // Loaded ahead of being tuned in, and not tuned in since
+        bool prefetched;
+    };
+    CompileWorker &worker;
+    std::vector<Entry> entries;
+
+  private:
+    void load(int ix, double time);
+    void evict(int ix, double time);
+    // Evicts least recently used sketches, except those used at time, until bytes more fit in the budget
+    void make_room(size_t bytes, double time);
+
+  public:
+    Residency(CompileWorker &worker);
+    // Returns the station's index
+    int add(SketchBase *sketch);
+    // The station is tuned in: loads it if needed. Call every frame; a station used this frame isn't evicted.
+    void use(int ix, double time);
+    // Same for the station expected to be tuned in next
+    void prefetch(int ix, double time);
+    bool loaded(int ix) const { return entries[ix].state == lsLoaded; }
+    // Picks up finished loads; once per frame, after use() and prefetch()
+    void poll(double time);
+
+    // Bench reporter: resident memory, evictions, and how well prefetching did
+    static void report(std::string &out, int frames);
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "resolution_governor.h"
+
+// Local dependencies
+#include "bench.h"
+
+// Global
+#include <cstdio>
+
+struct Step
+{
+    float scale;
+    ShaderQuality quality;
+};
+
+static const Step ladder[] = {
+    {1.0f, sqHigh},
+    {0.75f, sqHigh},
+    {0.75f, sqMedium},
+    {0.5f, sqMedium},
+    {0.5f, sqLow},
+};
+static const int ladder_size = sizeof(ladder) / sizeof(ladder[0]);
+static const char *quality_names[sqCount] = {"low", "medium", "high"};
+
+// A frame this far over budget missed its vblank
+static const double over_factor = 1.25;
+// Steps down once this many of the last window_frames ran over
+static const int window_frames = 25;
+static const int window_limit = 3;
+// Time on budget before trying a step up; doubled each time a try fails, up to the max
+static const double probe_wait_min = 5;
+static const double probe_wait_max = 80;
+// A step down this soon after a step up means the try failed
+static const double probe_fail_window = 10;
+
+// Statistics for the bench report, per period
+static double period_sec_at[ladder_size] = {};
+static int period_changes = 0;
+
+ResolutionGovernor::ResolutionGovernor(double budget_sec)
+    : budget_sec(budget_sec)
+{
+}
+
+int ResolutionGovernor::add(bool variants)
+{
+    entries.push_back({0, 0, probe_wait_min, -1, variants});
+    return (int)entries.size() - 1;
+}
+
+void ResolutionGovernor::set_min_step(int step)
+{
+    min_step = step < 0 ? 0 : step < ladder_size ? step : ladder_size - 1;
+}
+
+int ResolutionGovernor::step(int ix) const
+{
+    return entries[ix].level > min_step ? entries[ix].level : min_step;
+}
+
+float ResolutionGovernor::scale(int ix) const
+{
+    return ladder[step(ix)].scale;
+}
+
+ShaderQuality ResolutionGovernor::quality(int ix) const
+{
+    return ladder[step(ix)].quality;
+}
+
+bool ResolutionGovernor::same_effect(int ix, int a, int b) const
+{
+    if (ladder[a].scale != ladder[b].scale) return false;
+    return !entries[ix].variants || ladder[a].quality == ladder[b].quality;
+}
+
+int ResolutionGovernor::step_down(int ix) const
+{
+    int level = entries[ix].level;
+    for (int next = level + 1; next < ladder_size; ++next)
+        if (!same_effect(ix, level, next)) return next;
+    return -1;
+}
+
+int ResolutionGovernor::step_up(int ix) const
+{
+    // To the first of the steps that render the same way, so that the next step down changes something too
+    int level = entries[ix].level;
+    int next = level - 1;
+    while (next >= 0 && same_effect(ix, level, next))
+        --next;
+    if (next < 0) return -1;
+    while (next > 0 && same_effect(ix, next, next - 1))
+        --next;
+    return next;
+}
+
+void ResolutionGovernor::change_level(int ix, int level, double time)
+{
+    Entry &e = entries[ix];
+    const Step &from = ladder[e.level], &to = ladder[level];
+    printf("\nStation %d render scale %d%% %s -> %d%% %s after %.1f sec\n", ix,
+           (int)(from.scale * 100 + 0.5f), quality_names[from.quality],
+           (int)(to.scale * 100 + 0.5f), quality_names[to.quality], time - e.level_since);
+    e.level = level;
+    e.level_since = time;
+    window_count = 0;
+    window_over = 0;
+    last_over = time;
+    ++period_changes;
+}
+
+void ResolutionGovernor::frame(int ix, double frame_sec, double time)
+{
+    Entry &e = entries[ix];
+    if (ix != current_ix)
+    {
+        // Start over on the newly tuned station, without holding its last run's overruns against it
+        current_ix = ix;
+        window_count = 0;
+        window_over = 0;
+        last_over = time;
+    }
+    period_sec_at[step(ix)] += frame_sec;
+
+    if (frame_sec > budget_sec * over_factor)
+    {
+        ++window_over;
+        last_over = time;
+    }
+    if (++window_count >= window_frames)
+    {
+        window_count = 0;
+        window_over = 0;
+    }
+
+    int down = step_down(ix);
+    int up = step_up(ix);
+    if (window_over >= window_limit && down >= 0)
+    {
+        if (e.probed_at >= 0 && time - e.probed_at < probe_fail_window)
+        {
+            e.probe_wait *= 2;
+            if (e.probe_wait > probe_wait_max) e.probe_wait = probe_wait_max;
+        }
+        e.probed_at = -1;
+        change_level(ix, down, time);
+    }
+    else if (up >= 0 && time - last_over >= e.probe_wait)
+    {
+        e.probed_at = time;
+        change_level(ix, up, time);
+    }
+}
+
+void ResolutionGovernor::report(std::string &out, int frames)
+{
+    double total = 0;
+    for (int i = 0; i < ladder_size; ++i)
+        total += period_sec_at[i];
+    if (total > 0)
+    {
+        bench_appendf(out, "  Render scale:");
+        for (int i = 0; i < ladder_size; ++i)
+            bench_appendf(out, " %d%% %s %.0f%%%s", (int)(ladder[i].scale * 100 + 0.5f), quality_names[ladder[i].quality],
+                          period_sec_at[i] / total * 100, i < ladder_size - 1 ? "," : "");
+        bench_appendf(out, " of sketch time; %d changes\n", period_changes);
+    }
+    for (int i = 0; i < ladder_size; ++i)
+        period_sec_at[i] = 0;
+    period_changes = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef RESOLUTION_GOVERNOR_H
+#define RESOLUTION_GOVERNOR_H
+
+#include "sketch_base.h"
+
+#include <string>
+#include <vector>
+
+// Picks each station's render resolution, 100% down to 50% of its base render scale, and its shader quality
+// from a ladder of steps, to keep its frames within the frame budget. Steps that change nothing for a station,
+// like a shader quality it has no variants of, are skipped. Steps down when frames keep running over,
+// and tries the next step up after a while on budget; a try that runs over again makes the next one wait twice
+// as long. Render thread only.
+class ResolutionGovernor
+{
+  private:
+    struct Entry
+    {
+        int level;
+        double level_since;
+        // Time on budget before trying the next step up
+        double probe_wait;
+        // When the last step up was tried, or -1
+        double probed_at;
+        // Whether the sketch has shader quality variants; else steps that only change quality are skipped
+        bool variants;
+    };
+    const double budget_sec;
+    std::vector<Entry> entries;
+    int min_step = 0;
+    int current_ix = -1;
+    // Over-budget frames among the current station's last window_frames
+    int window_count = 0;
+    int window_over = 0;
+    double last_over = 0;
+
+  private:
+    void change_level(int ix, int level, double time);
+    // Ladder step in use: the station's own, or min_step if that's further down
+    int step(int ix) const;
+    // Whether two steps render the station the same way
+    bool same_effect(int ix, int a, int b) const;
+    // The station's next step down or up that changes anything, or -1 if there is none
+    int step_down(int ix) const;
+    int step_up(int ix) const;
+
+  public:
+    ResolutionGovernor(double budget_sec);
+    // Returns the station's index; variants as in SketchBase::has_quality_variants
+    int add(bool variants);
+    // Keeps every station at least this many ladder steps down, e.g. while the SoC runs hot; 0 lifts it.
+    // Stations' own steps carry on underneath.
+    void set_min_step(int step);
+    // Factor for the station's base render scale
+    float scale(int ix) const;
+    ShaderQuality quality(int ix) const;
+    // The station drew a frame, which took frame_sec including any wait for the display
+    void frame(int ix, double frame_sec, double time);
+
+    // Bench reporter: share of sketch time at each step, and step changes
+    static void report(std::string &out, int frames);
+};
+
+#endif
@@ -11,7 +11,13 @@ out vec4 fragColor;
 const float rayGravity = 0.25;
 const float terrainHeight = 5.0;
 
+#if QUALITY == 0
+const int MAX_STEPS = 4;
+#elif QUALITY == 1
+const int MAX_STEPS = 5;
+#else
 const int MAX_STEPS = 7;
+#endif
 
 float sdf(vec3 p) {
   float height = -texture(noiseTex, p.xz * 0.0087).r * terrainHeight; 
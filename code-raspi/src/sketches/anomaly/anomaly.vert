@@ -2,6 +2,9 @@
 precision highp float;
 layout(location = 0) in vec2 position;
 
+uniform vec2 resolution;
+uniform vec4 visibleRect;
+
 out vec2 vXZ;
 
 const float aspectRatio = 720.0 / 576.0;
@@ -11,5 +14,8 @@ void main()
 {
     gl_Position = vec4(position, 0.0, 1.0);
     // Precompute normalized dome coordinates in VS and interpolate.
-    vXZ = vec2(position.x * aspectRatio, position.y) * invCornerRadius;
+    // Relative to the center of the area the CRT shows
+    vec2 center = (visibleRect.xy + visibleRect.zw * 0.5) / resolution * 2.0 - 1.0;
+    vec2 p = position - center;
+    vXZ = vec2(p.x * aspectRatio, p.y) * invCornerRadius;
 }
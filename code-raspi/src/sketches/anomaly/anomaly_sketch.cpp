@@ -1,5 +1,9 @@
 #include "anomaly_sketch.h"
 
+#include "gl_state.h"
+#include "gpu_resources.h"
+#include "render_pass.h"
+
 // GLSL
 #include "shaders.h"
 
@@ -111,11 +115,11 @@ void main() {
 }
 )";
 
-static GLuint create_noise_texture_gpu(const std::vector<GLfloat> &quad)
+static GLuint create_noise_texture_gpu()
 {
   GLuint tex = 0;
   glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
+  gl_bind_texture_for_edit(0, tex);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -124,102 +128,60 @@ static GLuint create_noise_texture_gpu(const std::vector<GLfloat> &quad)
 
   GLuint fbo = 0;
   glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  gl_bind_framebuffer(fbo);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
 
-  GLuint vs = SketchBase::compile_shader(GL_VERTEX_SHADER, noise_gen_vert);
-  GLuint fs = SketchBase::compile_shader(GL_FRAGMENT_SHADER, noise_gen_frag);
-  GLuint prog = glCreateProgram();
-  glAttachShader(prog, vs);
-  glAttachShader(prog, fs);
-  glBindAttribLocation(prog, 0, "position");
-  glLinkProgram(prog);
-  GLint ok = 0;
-  glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-  if (!ok) SketchBase::throw_shader_link_error(prog);
-
-  GLuint vbo = 0;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * quad.size(), &quad[0], GL_STATIC_DRAW);
-
-  glDisable(GL_BLEND);
-  glDisable(GL_DEPTH_TEST);
-  glViewport(0, 0, NOISE_TEX_SIZE, NOISE_TEX_SIZE);
-  glUseProgram(prog);
-  GLint scale0_loc = glGetUniformLocation(prog, "octave0Scale");
-  GLint scale1_loc = glGetUniformLocation(prog, "octave1Scale");
-  GLint texsz_loc = glGetUniformLocation(prog, "noiseTexSize");
-  glUniform1f(scale0_loc, OCTAVE0_SCALE);
-  glUniform1f(scale1_loc, OCTAVE1_SCALE);
-  glUniform1f(texsz_loc, (float)NOISE_TEX_SIZE);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
+  ShaderProgram prog;
+  prog.build(noise_gen_vert, noise_gen_frag);
+
+  GLuint vbo = acquire_quad_vbo();
+
+  prog.use();
+  prog.set(prog.uniform("octave0Scale"), OCTAVE0_SCALE);
+  prog.set(prog.uniform("octave1Scale"), OCTAVE1_SCALE);
+  prog.set(prog.uniform("noiseTexSize"), (float)NOISE_TEX_SIZE);
+
+  gl_position_attrib(vbo);
+  RenderPass pass = {fbo, NOISE_TEX_SIZE, NOISE_TEX_SIZE, loClear, soStore, false, false};
+  begin_pass(pass);
   glDrawArrays(GL_TRIANGLES, 0, 6);
+  end_pass(pass);
 
-  glDeleteBuffers(1, &vbo);
-  glDeleteProgram(prog);
-  glDeleteShader(fs);
-  glDeleteShader(vs);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glDeleteFramebuffers(1, &fbo);
+  release_quad_vbo(vbo);
+  prog.release();
+  gl_delete_framebuffer(fbo);
   return tex;
 }
 } // namespace
 
 AnomalySketch::AnomalySketch(int w, int h, GLuint render_fbo)
-    : FragSketch(w, h, render_fbo, anomaly_frag)
+    : FragSketch(w, h, render_fbo, anomaly_frag, anomaly_vert)
 {
 }
 
 void AnomalySketch::init()
 {
-    vs = compile_shader(GL_VERTEX_SHADER, anomaly_vert);
-    fs = compile_shader(GL_FRAGMENT_SHADER, anomaly_frag);
-
-    prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    const GLint ixPosAttribute = 0;
-    glBindAttribLocation(prog, ixPosAttribute, "position");
-    glLinkProgram(prog);
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) throw_shader_link_error(prog);
-
-    glDisable(GL_BLEND);
-    glDisable(GL_DEPTH_TEST);
-
-    glGenBuffers(1, &anomaly_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, anomaly_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * quad.size(), &quad[0], GL_STATIC_DRAW);
-
-    glUseProgram(prog);
-    camera_pos_loc = glGetUniformLocation(prog, "cameraPos");
-    camera_basis_loc = glGetUniformLocation(prog, "cameraBasis");
-    hash_offset_loc = glGetUniformLocation(prog, "hashOffset");
-    noise_tex_loc = glGetUniformLocation(prog, "noiseTex");
-
-    noise_tex = create_noise_texture_gpu(quad);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, noise_tex);
-    glUniform1i(noise_tex_loc, 0);
+    FragSketch::init();
+    noise_tex = acquire_texture("anomaly-noise", create_noise_texture_gpu);
+}
+
+void AnomalySketch::get_uniforms()
+{
+    FragSketch::get_uniforms();
+    camera_pos_uni = prog.uniform("cameraPos");
+    camera_basis_uni = prog.uniform("cameraBasis");
+    hash_offset_uni = prog.uniform("hashOffset");
+    noise_tex_uni = prog.uniform("noiseTex");
 }
 
 void AnomalySketch::frame(double dt)
 {
     time += dt;
 
-    glUseProgram(prog);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, noise_tex);
-
-    glBindBuffer(GL_ARRAY_BUFFER, anomaly_vbo);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    prog.use();
+    gl_bind_texture(0, noise_tex);
+    prog.set(noise_tex_uni, 0);
+    gl_bind_vertex_array(quad_vao());
 
     float t = (float)time;
     float rt = sinf(t * 0.3f);
@@ -228,39 +190,28 @@ void AnomalySketch::frame(double dt)
     float rightx = upy;
     float righty = -upx;
 
-    glUniform3f(camera_pos_loc, t, 2.0f, 0.0f);
-    glUniform4f(camera_basis_loc, upx, upy, rightx, righty);
+    prog.set(camera_pos_uni, t, 2.0f, 0.0f);
+    prog.set(camera_basis_uni, upx, upy, rightx, righty);
     float h0 = t * 0.001f;
     float h1 = t * 0.001731f + 0.37f;
-    glUniform2f(hash_offset_loc, h0, h1);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, render_fbo);
-    glViewport(0, 0, w, h);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    prog.set(hash_offset_uni, h0, h1);
+    set_common_uniforms();
+
+    // Opaque full-screen quad: no need to load or clear the target
+    RenderPass pass = {render_fbo, vw, vh, output_load(loDontCare), soStore, true, false};
+    begin_pass(pass);
+    draw_output();
+    end_pass(pass);
 }
 
-void AnomalySketch::unload(double current_time)
+size_t AnomalySketch::gpu_bytes() const
 {
-    if (anomaly_vbo != 0)
-    {
-        glDeleteBuffers(1, &anomaly_vbo);
-        anomaly_vbo = 0;
-    }
-    if (noise_tex != 0)
-    {
-        glDeleteTextures(1, &noise_tex);
-        noise_tex = 0;
-    }
-    glDeleteProgram(prog);
-    prog = 0;
-    glDeleteShader(fs);
-    fs = 0;
-    glDeleteShader(vs);
-    vs = 0;
+    // The noise texture is shared, but nothing else uses it
+    return FragSketch::gpu_bytes() + (size_t)NOISE_TEX_SIZE * NOISE_TEX_SIZE * 4;
 }
 
-void AnomalySketch::reload(double current_time)
+void AnomalySketch::unload(double current_time)
 {
-    time = current_time;
-    init();
+    release_texture(noise_tex);
+    FragSketch::unload(current_time);
 }
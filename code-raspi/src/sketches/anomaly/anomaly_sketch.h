@@ -6,19 +6,21 @@
 class AnomalySketch : public FragSketch
 {
   private:
-    GLint camera_pos_loc = -1;
-    GLint camera_basis_loc = -1;
-    GLint hash_offset_loc = -1;
-    GLint noise_tex_loc = -1;
-    GLuint anomaly_vbo = 0;
+    ShaderProgram::Uniform camera_pos_uni;
+    ShaderProgram::Uniform camera_basis_uni;
+    ShaderProgram::Uniform hash_offset_uni;
+    ShaderProgram::Uniform noise_tex_uni;
     GLuint noise_tex = 0;
 
+  protected:
+    void get_uniforms() override;
+
   public:
     AnomalySketch(int w, int h, GLuint render_fbo);
     void init() override;
     void frame(double dt) override;
     void unload(double current_time) override;
-    void reload(double current_time) override;
+    size_t gpu_bytes() const override;
 };
 
 #endif
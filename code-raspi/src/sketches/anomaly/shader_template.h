@@ -1,9 +1,10 @@
 #ifndef ANOMALY_SHADERS_H
 #define ANOMALY_SHADERS_H
 
-constexpr const char *anomaly_frag = R"(
-SRC anomaly.frag
-)";
+// One per ShaderQuality
+constexpr const char *anomaly_frag[] = {
+VARIANTS anomaly.frag
+};
 
 constexpr const char *anomaly_vert = R"(
 SRC anomaly.vert
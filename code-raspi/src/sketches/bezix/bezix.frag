@@ -3,6 +3,7 @@ precision highp float;
 
 uniform float time;
 uniform vec2 resolution;
+uniform vec4 visibleRect;
 out vec4 fragColor;
 
 //v2
@@ -23,7 +24,7 @@ float color(vec2 uv, float off) {
     return distance(a, b);
 }
 void main() {
-    vec2 uv = gl_FragCoord.xy / resolution;
+    vec2 uv = (gl_FragCoord.xy - visibleRect.xy - visibleRect.zw * 0.5) / resolution + 0.5;
     vec3 c = vec3(color(uv, .0), color(uv, .01), color(uv, .02));
     vec3 col = vec3(1.0 / (0.1 + c * 5.0));
     fragColor = vec4(col, 1.0);
@@ -7,26 +7,29 @@
 class CellSketch : public SketchBase
 {
   private:
-    const int w, h;
-    const GLuint render_fbo;
-    GLuint vs0 = 0;
-    GLuint fs0 = 0;
-    GLuint vs1 = 0;
-    GLuint fs1 = 0;
-    GLuint prog0 = 0;
-    GLuint prog1 = 0;
-    GLuint vbo = 0;
+    ShaderProgram prog0;
+    ShaderProgram prog1;
+    ShaderProgram::Uniform time0_uni;
+    ShaderProgram::Uniform resolution0_uni;
+    ShaderProgram::Uniform calc01_uni;
+    ShaderProgram::Uniform calc02_uni;
+    ShaderProgram::Uniform tex_o1_uni;
+    ShaderProgram::Uniform rotate_opt_c_uni;
+    ShaderProgram::Uniform rotate_opt_s_uni;
+    ShaderProgram::Uniform o1_scale_uni;
+    ShaderProgram::Uniform time1_uni;
+    ShaderProgram::Uniform resolution1_uni;
     GLuint o1_tex = 0;
     GLuint o1_fbo = 0;
-    GLuint o1_depth = 0;
-    double time;
+    double time = 0;
 
   public:
     CellSketch(int w, int h, GLuint render_fbo);
     virtual void init() override;
+    virtual void start(double current_time) override;
     virtual void frame(double dt) override;
     virtual void unload(double current_time) override;
-    virtual void reload(double current_time) override;
+    virtual size_t gpu_bytes() const override;
 };
 
 #endif
@@ -6,6 +6,7 @@ uniform float calc02; // Math.sin(time * 0.5) + 1.0) * 0.12
 uniform float rotate_opt_c; // cos(1 + 0.1 * time)
 uniform float rotate_opt_s; // sin(1 + 0.1 * time)
 uniform sampler2D tex_o1;
+uniform vec2 o1Scale;
 uniform float time;
 uniform vec2 resolution;
 varying vec2 uv;
@@ -148,7 +149,7 @@ vec2 scale(vec2 _st, float amount, float xMult, float yMult, float offsetX, floa
 
 vec4 src(vec2 _st, sampler2D tex) {
     //  vec2 uv = gl_FragCoord.xy/vec2(1280., 720.);
-    return texture2D(tex, fract(_st));
+    return texture2D(tex, fract(_st) * o1Scale);
 }
 
 vec4 osc(vec2 _st, float frequency, float sync, float offset) {
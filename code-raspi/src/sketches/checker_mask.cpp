@@ -0,0 +1,50 @@
+#include "checker_mask.h"
+
+// Local dependencies
+#include "gl_state.h"
+#include "shader_program.h"
+
+// GLSL
+#include "shaders.h"
+
+// Global
+#include <GLES3/gl3.h>
+
+// Render thread only; built on first use
+static ShaderProgram mask_prog;
+static ShaderProgram::Uniform phase_uni;
+
+void begin_checker_mask(int phase)
+{
+    GLuint sketch_prog = gl_current_program();
+    if (mask_prog.id() == 0)
+    {
+        mask_prog.build(sweep_vert, checker_frag);
+        phase_uni = mask_prog.uniform("phase");
+    }
+
+    // The pass's first stencil access: a tile clear rather than a load
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+
+    gl_set_enabled(GL_STENCIL_TEST, true);
+    glStencilFunc(GL_ALWAYS, 1, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    mask_prog.use();
+    mask_prog.set(phase_uni, phase);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    // Early stencil test: masked cells are never shaded
+    glStencilFunc(GL_EQUAL, 1, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    gl_use_program(sketch_prog);
+}
+
+void end_checker_mask()
+{
+    gl_set_enabled(GL_STENCIL_TEST, false);
+    const GLenum attachment = GL_STENCIL_ATTACHMENT;
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);
+}
@@ -0,0 +1,15 @@
+#ifndef CHECKER_MASK_H
+#define CHECKER_MASK_H
+
+// Checkerboard rendering: a final pass shades only the cells of one phase, half of the target, and
+// RenderBlender fills in the other half from the frame before. Cells are 2 x 2 pixels; those of phase p
+// have (x / 2 + y / 2) % 2 == p, counted in pixels from the target's bottom left.
+
+// Within a pass on a target with a stencil attachment, with the quad's vertices bound to attribute 0:
+// marks the cells of phase in the stencil buffer, and restricts the following draws to them.
+// The current program stays current.
+void begin_checker_mask(int phase);
+// Lifts the restriction, and drops the stencil contents, which nothing needs after the pass
+void end_checker_mask();
+
+#endif
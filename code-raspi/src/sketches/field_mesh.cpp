@@ -0,0 +1,35 @@
+#include "field_mesh.h"
+
+// Local dependencies
+#include "gl_state.h"
+
+// Global
+#include <vector>
+
+void FieldMesh::draw(int field, int h)
+{
+    if (vbo == 0) glGenBuffers(1, &vbo);
+    gl_bind_array_buffer(vbo);
+
+    if (h != this->h)
+    {
+        // Field 0's rows first. Lines overshoot the viewport so the first and last column are included.
+        std::vector<GLfloat> lines;
+        lines.reserve(h * 4);
+        for (int f = 0; f < 2; ++f)
+        {
+            for (int row = f; row < h; row += 2)
+            {
+                float y = 1.0f - (row + 0.5f) * 2.0f / h;
+                lines.insert(lines.end(), {-1.01f, y, 1.01f, y});
+            }
+        }
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * lines.size(), &lines[0], GL_STATIC_DRAW);
+        this->h = h;
+    }
+
+    gl_position_attrib(vbo);
+    int field0_rows = (h + 1) / 2;
+    if (field == 0) glDrawArrays(GL_LINES, 0, field0_rows * 2);
+    else glDrawArrays(GL_LINES, field0_rows * 2, (h / 2) * 2);
+}
@@ -0,0 +1,20 @@
+#ifndef FIELD_MESH_H
+#define FIELD_MESH_H
+
+#include <GLES2/gl2.h>
+
+// One horizontal line through each pixel row, so that a pass can shade only the rows of one
+// interlaced field. Works with any vertex shader that takes clip-space positions, like the sweep quad.
+class FieldMesh
+{
+  private:
+    GLuint vbo = 0;
+    int h = 0;
+
+  public:
+    // Draws the rows of field 0 (rows 0, 2, ... counted from the top) or 1 of a viewport h rows high.
+    // Points vertex attribute 0 at the mesh's own buffer.
+    void draw(int field, int h);
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "gl_state.h"
+
+// Local dependencies
+#include "bench.h"
+
+// Global
+#include <GLES3/gl3.h>
+
+static const int max_texture_units = 8;
+
+// One copy per thread, as each thread has its own context (compile_worker.h).
+// Initial values are GL's defaults; a viewport of 0 x 0 is never requested, so the first one goes through
+static thread_local GLuint program = 0;
+static thread_local GLuint array_buffer = 0;
+static thread_local int active_unit = 0;
+static thread_local GLuint textures[max_texture_units] = {0};
+static thread_local GLuint framebuffer = 0;
+static thread_local bool blend = false, depth_test = false, scissor_test = false, stencil_test = false;
+static thread_local GLenum blend_src = GL_ONE, blend_dst = GL_ZERO;
+static thread_local int viewport[4] = {0, 0, 0, 0};
+static thread_local int scissor[4] = {0, 0, 0, 0};
+static thread_local GLuint vertex_array = 0;
+// Attribute 0 of the default vertex array
+static thread_local bool position_enabled = false;
+static thread_local GLuint position_buffer = 0;
+
+// Counted per thread: the report covers the render thread
+static thread_local long calls = 0;
+static thread_local long redundant = 0;
+
+// Counts a call; true if it would change state
+static bool changes(bool differs)
+{
+    ++calls;
+    if (!differs) ++redundant;
+    return differs;
+}
+
+static bool rect_differs(const int cur[4], int x, int y, int w, int h)
+{
+    return cur[0] != x || cur[1] != y || cur[2] != w || cur[3] != h;
+}
+
+void gl_use_program(GLuint prog)
+{
+    if (!changes(prog != program)) return;
+    glUseProgram(prog);
+    program = prog;
+}
+
+GLuint gl_current_program()
+{
+    return program;
+}
+
+void gl_bind_array_buffer(GLuint buf)
+{
+    if (!changes(buf != array_buffer)) return;
+    glBindBuffer(GL_ARRAY_BUFFER, buf);
+    array_buffer = buf;
+}
+
+void gl_bind_texture(int unit, GLuint tex)
+{
+    if (!changes(tex != textures[unit])) return;
+    if (unit != active_unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        active_unit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, tex);
+    textures[unit] = tex;
+}
+
+void gl_bind_texture_for_edit(int unit, GLuint tex)
+{
+    if (unit != active_unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        active_unit = unit;
+    }
+    gl_bind_texture(unit, tex);
+}
+
+void gl_bind_framebuffer(GLuint fbo)
+{
+    if (!changes(fbo != framebuffer)) return;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    framebuffer = fbo;
+}
+
+void gl_set_enabled(GLenum cap, bool enabled)
+{
+    bool *cur = cap == GL_BLEND        ? &blend
+                : cap == GL_DEPTH_TEST   ? &depth_test
+                : cap == GL_STENCIL_TEST ? &stencil_test
+                                         : &scissor_test;
+    if (!changes(enabled != *cur)) return;
+    if (enabled) glEnable(cap);
+    else glDisable(cap);
+    *cur = enabled;
+}
+
+void gl_blend_func(GLenum src, GLenum dst)
+{
+    if (!changes(src != blend_src || dst != blend_dst)) return;
+    glBlendFunc(src, dst);
+    blend_src = src;
+    blend_dst = dst;
+}
+
+void gl_viewport(int x, int y, int w, int h)
+{
+    if (!changes(rect_differs(viewport, x, y, w, h))) return;
+    glViewport(x, y, w, h);
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = w;
+    viewport[3] = h;
+}
+
+void gl_scissor(int x, int y, int w, int h)
+{
+    if (!changes(rect_differs(scissor, x, y, w, h))) return;
+    glScissor(x, y, w, h);
+    scissor[0] = x;
+    scissor[1] = y;
+    scissor[2] = w;
+    scissor[3] = h;
+}
+
+void gl_bind_vertex_array(GLuint vao)
+{
+    if (!changes(vao != vertex_array)) return;
+    glBindVertexArray(vao);
+    vertex_array = vao;
+}
+
+void gl_position_attrib(GLuint buf)
+{
+    gl_bind_vertex_array(0);
+    gl_bind_array_buffer(buf);
+    if (changes(!position_enabled))
+    {
+        glEnableVertexAttribArray(0);
+        position_enabled = true;
+    }
+    // The pointer captures the buffer bound when it is set
+    if (changes(buf != position_buffer))
+    {
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        position_buffer = buf;
+    }
+}
+
+void gl_delete_program(GLuint &prog)
+{
+    if (prog == 0) return;
+    if (prog == program) program = 0;
+    glDeleteProgram(prog);
+    prog = 0;
+}
+
+void gl_delete_buffer(GLuint &buf)
+{
+    if (buf == 0) return;
+    // Deleting unbinds it, from the attribute too
+    if (buf == array_buffer) array_buffer = 0;
+    if (buf == position_buffer) position_buffer = 0;
+    glDeleteBuffers(1, &buf);
+    buf = 0;
+}
+
+void gl_delete_texture(GLuint &tex)
+{
+    if (tex == 0) return;
+    for (int i = 0; i < max_texture_units; ++i)
+        if (textures[i] == tex) textures[i] = 0;
+    glDeleteTextures(1, &tex);
+    tex = 0;
+}
+
+void gl_delete_framebuffer(GLuint &fbo)
+{
+    if (fbo == 0) return;
+    if (fbo == framebuffer) framebuffer = 0;
+    glDeleteFramebuffers(1, &fbo);
+    fbo = 0;
+}
+
+void gl_unbind_objects()
+{
+    gl_use_program(0);
+    gl_bind_array_buffer(0);
+    for (int i = 0; i < max_texture_units; ++i) gl_bind_texture(i, 0);
+    gl_bind_framebuffer(0);
+    // The attribute pointer holds on to its buffer too
+    gl_bind_vertex_array(0);
+    if (position_enabled)
+    {
+        glDisableVertexAttribArray(0);
+        position_enabled = false;
+    }
+    position_buffer = 0;
+}
+
+void report_gl_state(std::string &out, int frames)
+{
+    double pct = calls ? redundant * 100.0 / calls : 0;
+    bench_appendf(out, "  GL state calls: %.1f/frame, %.1f/frame redundant and filtered (%.0f%%)\n",
+                  (double)calls / frames, (double)redundant / frames, pct);
+    calls = 0;
+    redundant = 0;
+}
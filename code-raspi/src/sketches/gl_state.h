@@ -0,0 +1,41 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GLES2/gl2.h>
+#include <string>
+
+// Shadow copy of the GL state the app changes: calls that wouldn't change anything are dropped
+// before they reach the driver. Sketches and RenderBlender make all of these calls through here,
+// and delete objects through the gl_delete_* wrappers so that a recycled name isn't taken as bound.
+
+void gl_use_program(GLuint prog);
+GLuint gl_current_program();
+void gl_bind_array_buffer(GLuint buf);
+// Binds a 2D texture on texture unit (0-based)
+void gl_bind_texture(int unit, GLuint tex);
+// Same, and leaves unit active even if tex was bound already: use before glTexImage2D, glTexParameteri etc.
+void gl_bind_texture_for_edit(int unit, GLuint tex);
+void gl_bind_framebuffer(GLuint fbo);
+// GL_BLEND, GL_DEPTH_TEST, GL_SCISSOR_TEST or GL_STENCIL_TEST
+void gl_set_enabled(GLenum cap, bool enabled);
+void gl_blend_func(GLenum src, GLenum dst);
+void gl_viewport(int x, int y, int w, int h);
+void gl_scissor(int x, int y, int w, int h);
+void gl_bind_vertex_array(GLuint vao);
+// Sources vertex attribute 0, the vec2 position of all our vertex shaders, from buf. Binds the default
+// vertex array first: the attribute state shadowed here is its own.
+void gl_position_attrib(GLuint buf);
+
+void gl_delete_program(GLuint &prog);
+void gl_delete_buffer(GLuint &buf);
+void gl_delete_texture(GLuint &tex);
+void gl_delete_framebuffer(GLuint &fbo);
+
+// Unbinds everything, for a context whose objects other contexts delete (compile_worker.h): a binding
+// keeps a deleted object alive, and its recycled name would be taken as bound
+void gl_unbind_objects();
+
+// Bench reporter: state calls per frame, and how many of them were filtered as redundant
+void report_gl_state(std::string &out, int frames);
+
+#endif
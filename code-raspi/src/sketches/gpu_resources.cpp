@@ -0,0 +1,150 @@
+#include "gpu_resources.h"
+
+// Local dependencies
+#include "bench.h"
+#include "error.h"
+#include "gl_state.h"
+#include "lock.h"
+#include "sketch_base.h"
+
+// Global
+#include <GLES3/gl3.h>
+#include <map>
+
+namespace
+{
+// Acquired on the render thread and the compile worker's
+pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
+
+struct Shared
+{
+    GLuint name;
+    int refs;
+};
+
+// Keyed by source text; a sweep shader compiled into each sketch's shaders.h is still the same shader
+std::map<std::string, Shared> shaders;
+std::map<std::string, Shared> textures;
+Shared quad = {0, 0};
+// Per context, like gl_state's shadow
+thread_local GLuint vao = 0;
+int acquires = 0;
+int builds = 0;
+
+// "Sweep" vertex shader's two fixed triangles
+const GLfloat quad_verts[] = {-1, -1, 1, -1, -1, 1, -1, 1, 1, -1, 1, 1};
+
+void release(std::map<std::string, Shared> &objects, GLuint &name, const char *what)
+{
+    if (name == 0) return;
+    for (auto &it : objects)
+    {
+        if (it.second.name != name) continue;
+        if (it.second.refs <= 0) THROWF("Shared %s %u released more often than acquired", what, name);
+        --it.second.refs;
+        name = 0;
+        return;
+    }
+    THROWF("Releasing %s %u, which is not shared", what, name);
+}
+} // namespace
+
+GLuint acquire_quad_vbo()
+{
+    Lock lock(&mut);
+    ++acquires;
+    if (quad.name == 0)
+    {
+        ++builds;
+        glGenBuffers(1, &quad.name);
+        gl_bind_array_buffer(quad.name);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad_verts), quad_verts, GL_STATIC_DRAW);
+    }
+    ++quad.refs;
+    return quad.name;
+}
+
+void release_quad_vbo(GLuint &vbo)
+{
+    if (vbo == 0) return;
+    Lock lock(&mut);
+    if (vbo != quad.name || quad.refs <= 0) THROWF("Releasing buffer %u, which is not the shared quad", vbo);
+    --quad.refs;
+    vbo = 0;
+}
+
+GLuint quad_vao()
+{
+    if (vao != 0) return vao;
+    GLuint vbo = acquire_quad_vbo();
+    glGenVertexArrays(1, &vao);
+    gl_bind_vertex_array(vao);
+    gl_bind_array_buffer(vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    return vao;
+}
+
+GLuint acquire_shader(GLenum type, const char *src)
+{
+    Lock lock(&mut);
+    ++acquires;
+    std::string key = std::to_string(type) + ":" + src;
+    auto it = shaders.find(key);
+    if (it == shaders.end())
+    {
+        ++builds;
+        Shared s = {SketchBase::compile_shader(type, src), 0};
+        it = shaders.insert(std::make_pair(key, s)).first;
+    }
+    ++it->second.refs;
+    return it->second.name;
+}
+
+void release_shader(GLuint &shader)
+{
+    Lock lock(&mut);
+    release(shaders, shader, "shader");
+}
+
+GLuint acquire_texture(const char *name, TextureFactory create)
+{
+    {
+        Lock lock(&mut);
+        ++acquires;
+        auto it = textures.find(name);
+        if (it != textures.end())
+        {
+            ++it->second.refs;
+            return it->second.name;
+        }
+    }
+
+    // Unlocked: create acquires shared objects itself
+    GLuint tex = create();
+    Lock lock(&mut);
+    ++builds;
+    auto res = textures.insert(std::make_pair(std::string(name), Shared{tex, 0}));
+    // Lost a race with another thread creating it
+    if (!res.second) gl_delete_texture(tex);
+    ++res.first->second.refs;
+    return res.first->second.name;
+}
+
+void release_texture(GLuint &tex)
+{
+    Lock lock(&mut);
+    release(textures, tex, "texture");
+}
+
+void report_gpu_resources(std::string &out, int frames)
+{
+    Lock lock(&mut);
+    int held = quad.refs > 0 ? 1 : 0;
+    for (auto &it : shaders) held += it.second.refs > 0 ? 1 : 0;
+    for (auto &it : textures) held += it.second.refs > 0 ? 1 : 0;
+    int total = (quad.name ? 1 : 0) + (int)shaders.size() + (int)textures.size();
+    bench_appendf(out, "  Shared GPU objects: %d (%d in use); %d of %d acquires reused\n", total, held, acquires - builds, acquires);
+    acquires = 0;
+    builds = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+#include <GLES2/gl2.h>
+#include <string>
+
+// GPU objects that several sketches need the same copy of, shared and refcounted.
+// An object nobody holds stays alive, so unloading and reloading a station doesn't rebuild it.
+// The release functions zero the caller's name, like the gl_delete_* wrappers.
+
+// Full-screen quad for the sweep vertex shaders: two triangles of vec2 clip-space positions
+GLuint acquire_quad_vbo();
+void release_quad_vbo(GLuint &vbo);
+// Vertex array sourcing attribute 0 from the quad, so that drawing it takes one bind. Vertex arrays aren't
+// shared between contexts: each thread gets its own on first use, which holds on to the quad for good.
+GLuint quad_vao();
+
+// Compiled shader, shared by everyone passing the same source; throws on compile errors
+GLuint acquire_shader(GLenum type, const char *src);
+void release_shader(GLuint &shader);
+
+// Texture shared by name; create runs on the first acquire and leaves the texture's contents in place
+typedef GLuint (*TextureFactory)();
+GLuint acquire_texture(const char *name, TextureFactory create);
+void release_texture(GLuint &tex);
+
+// Bench reporter: shared objects, and how many acquires were served without building anything
+void report_gpu_resources(std::string &out, int frames);
+
+#endif
@@ -2,7 +2,30 @@
 
 pushd "$1" > /dev/null || { echo "Failed to cd into $1"; exit 1; }
 
+# SRC <file> pastes the file. VARIANTS <file> pastes it once per shader quality, as comma-separated
+# raw strings with "#define QUALITY <n>" after the #version line; n is 0 (low) to 2 (high).
 awk '
+/^[[:space:]]*VARIANTS[[:space:]]+/ {
+    sub(/^[[:space:]]*VARIANTS[[:space:]]+/, "", $0)
+    filename = $0
+
+    for (quality = 0; quality < 3; ++quality) {
+        if ((getline line < filename) < 0) {
+            missing = 1
+            next
+        }
+
+        print "R\"("
+        print line
+        print "#define QUALITY " quality
+        while ((getline line < filename) > 0)
+            print line
+        print ")\","
+
+        close(filename)
+    }
+    next
+}
 /^[[:space:]]*SRC[[:space:]]+/ {
     sub(/^[[:space:]]*SRC[[:space:]]+/, "", $0)
     filename = $0
@@ -5,6 +5,7 @@ precision highp float;
 
 uniform float time;
 uniform vec2 resolution;
+uniform vec4 visibleRect;
 out vec4 fragColor;
 
 vec2 rotate(vec2 p, float a) {
@@ -31,7 +32,7 @@ vec3 palette(float t) {
 }
 
 void main() {
-    vec2 p = (2.0 * gl_FragCoord.xy - resolution.xy) / resolution.y;
+    vec2 p = (2.0 * (gl_FragCoord.xy - visibleRect.xy) - visibleRect.zw) / resolution.y;
     // vec2 mouse = iMouse.xy / resolution.xy + 0.5;
     vec2 mouse = vec2(0.5);
 
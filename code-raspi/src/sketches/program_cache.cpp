@@ -0,0 +1,173 @@
+#include "program_cache.h"
+
+// Local dependencies
+#include "bench.h"
+#include "file_helpers.h"
+#include "gl_state.h"
+#include "lock.h"
+#include "options.h"
+
+// Global
+#include <GLES3/gl3.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+struct FileHeader
+{
+    char magic[4];
+    uint32_t format;
+    uint32_t length;
+};
+
+const char file_magic[4] = {'I', 'G', 'R', 'P'};
+
+// Programs are built on the render thread and the compile worker's
+pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
+int hits = 0;
+int misses = 0;
+int rejected = 0;
+bool store_failed = false;
+
+void count(int &counter)
+{
+    Lock lock(&mut);
+    ++counter;
+}
+
+uint64_t fnv1a(uint64_t hash, const char *str)
+{
+    // Include the terminator so that ("ab", "c") and ("a", "bc") differ
+    const unsigned char *p = (const unsigned char *)(str ? str : "");
+    do
+    {
+        hash ^= *p;
+        hash *= 0x100000001b3ull;
+    } while (*p++);
+    return hash;
+}
+
+bool cache_dir(std::string &dir)
+{
+    if (options.shader_cache.empty()) return false;
+    if (options.shader_cache[0] == '/') dir = options.shader_cache;
+    else path_from_bindir(options.shader_cache.c_str(), dir);
+    return true;
+}
+
+std::string file_path(const std::string &dir, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return dir + name;
+}
+} // namespace
+
+uint64_t program_cache_key(const char *vert_src, const char *frag_src)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = fnv1a(hash, vert_src);
+    hash = fnv1a(hash, frag_src);
+    hash = fnv1a(hash, (const char *)glGetString(GL_VENDOR));
+    hash = fnv1a(hash, (const char *)glGetString(GL_RENDERER));
+    hash = fnv1a(hash, (const char *)glGetString(GL_VERSION));
+    return hash;
+}
+
+GLuint load_cached_program(uint64_t key)
+{
+    std::string dir;
+    if (!cache_dir(dir)) return 0;
+
+    FILE *f = fopen(file_path(dir, key).c_str(), "rb");
+    if (!f)
+    {
+        count(misses);
+        return 0;
+    }
+    FileHeader hdr;
+    std::vector<uint8_t> data;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && memcmp(hdr.magic, file_magic, sizeof(file_magic)) == 0;
+    if (ok)
+    {
+        data.resize(hdr.length);
+        ok = hdr.length > 0 && fread(&data[0], 1, hdr.length, f) == hdr.length;
+    }
+    fclose(f);
+    if (!ok)
+    {
+        count(rejected);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    glProgramBinary(prog, hdr.format, &data[0], hdr.length);
+    GLint linked = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // Rebuilt from source and overwritten by the caller
+        gl_delete_program(prog);
+        count(rejected);
+        return 0;
+    }
+    count(hits);
+    return prog;
+}
+
+void prepare_cached_program(GLuint prog)
+{
+    if (options.shader_cache.empty()) return;
+    glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void store_cached_program(uint64_t key, GLuint prog)
+{
+    std::string dir;
+    if (!cache_dir(dir)) return;
+
+    GLint len = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0) return;
+    std::vector<uint8_t> data(len);
+    FileHeader hdr;
+    memcpy(hdr.magic, file_magic, sizeof(file_magic));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(prog, len, &written, &format, &data[0]);
+    if (written <= 0) return;
+    hdr.format = format;
+    hdr.length = written;
+
+    // Write next to the final name and rename, so that a crash never leaves a truncated binary
+    std::string path = file_path(dir, key);
+    std::string tmp_path = path + ".tmp";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) tmp_path.clear();
+    FILE *f = tmp_path.empty() ? nullptr : fopen(tmp_path.c_str(), "wb");
+    bool ok = f != nullptr;
+    if (f)
+    {
+        ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 && fwrite(&data[0], 1, written, f) == (size_t)written;
+        ok = fclose(f) == 0 && ok;
+        ok = ok && rename(tmp_path.c_str(), path.c_str()) == 0;
+        if (!ok) unlink(tmp_path.c_str());
+    }
+    if (!ok)
+    {
+        int err = errno;
+        Lock lock(&mut);
+        if (!store_failed) fprintf(stderr, "Cannot write shader cache in '%s': %s\n", dir.c_str(), strerror(err));
+        store_failed = true;
+    }
+}
+
+void report_program_cache(std::string &out, int frames)
+{
+    Lock lock(&mut);
+    bench_appendf(out, "  Program cache since start: %d hits, %d misses, %d rejected\n", hits, misses, rejected);
+}
@@ -0,0 +1,23 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <GLES2/gl2.h>
+#include <stdint.h>
+#include <string>
+
+// Linked program binaries on disk (options.shader_cache), so that programs are only compiled and linked
+// from source the first time. Keyed by the sources and the GL vendor, renderer and version: a driver
+// update misses instead of loading a stale binary.
+
+uint64_t program_cache_key(const char *vert_src, const char *frag_src);
+// Linked program from the cache; 0 on a miss, with the cache disabled, or if the driver rejects the binary
+GLuint load_cached_program(uint64_t key);
+// Call before glLinkProgram on a program that will be stored
+void prepare_cached_program(GLuint prog);
+// Saves a linked program's binary; failures only cost the next run a compile
+void store_cached_program(uint64_t key, GLuint prog);
+
+// Bench reporter: hits and misses since start
+void report_program_cache(std::string &out, int frames);
+
+#endif
@@ -3,6 +3,7 @@ precision highp float;
 
 uniform sampler2D bgTex;
 uniform vec2 resolution;
+uniform vec4 visibleRect;
 uniform vec3 camPos;
 uniform mat3 camMat;
 uniform mat3 rotMat;
@@ -97,8 +98,16 @@ vec3 march(vec3 ro, vec3 rd) {
     const float eps = 0.001;
     const float inner_escape = eps * 10.0;
     const float max_travel = 20.5;
+#if QUALITY == 0
+    const int max_intersections = 1;
+    const int max_steps = 48;
+#elif QUALITY == 1
+    const int max_intersections = 2;
+    const int max_steps = 64;
+#else
     const int max_intersections = 2;
     const int max_steps = 90;
+#endif
     float travel = 0.0;
     float nf = 1.0;
     vec3 c = vec3(0.0);
@@ -170,7 +179,7 @@ void main() {
     // sphere3 = vec4(vs2.x, vs2.y, vs2.w, 0.8 * 0.0);
 
     float ar = resolution.x / resolution.y;
-    vec2 uv = gl_FragCoord.xy / resolution - vec2(0.5);
+    vec2 uv = (gl_FragCoord.xy - visibleRect.xy - visibleRect.zw * 0.5) / resolution;
     vec3 nc = vec3(uv.x, uv.y / ar, 1.0);
     vec3 rd = normalize(camMat * nc);
     vec3 ro = camPos;
@@ -2,7 +2,10 @@
 
 // Local dependencies
 #include "geo_utils.h"
+#include "gl_state.h"
+#include "gpu_resources.h"
 #include "horrors.h"
+#include "render_pass.h"
 
 // GLSL
 #include "shaders.h"
@@ -27,41 +30,26 @@ void RaySketch::frame(double dt)
     calc_matrices();
 
     // Program to use
-    glUseProgram(prog);
+    prog.use();
 
     // Vertex array
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * quad.size(), &quad[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-    // Uniform locations
-    GLint time_loc = glGetUniformLocation(prog, "time");
-    GLint resolution_loc = glGetUniformLocation(prog, "resolution");
-    GLint cam_pos_loc = glGetUniformLocation(prog, "camPos");
-    GLint cam_mat_loc = glGetUniformLocation(prog, "camMat");
-    GLint rot_mat_loc = glGetUniformLocation(prog, "rotMat");
-    GLint bg_tex_loc = glGetUniformLocation(prog, "bgTex");
+    gl_bind_vertex_array(quad_vao());
 
     // Simple uniforms
-    glUniform1f(time_loc, (float)time);
-    glUniform2f(resolution_loc, (float)w, (float)h);
-    glUniform3f(cam_pos_loc, cam_pos.x, cam_pos.y, cam_pos.z);
-    glUniformMatrix3fv(cam_mat_loc, 1, GL_TRUE, cam_mat_arr);
-    glUniformMatrix3fv(rot_mat_loc, 1, GL_TRUE, rot_mat_arr);
+    set_common_uniforms();
+    prog.set(cam_pos_uni, cam_pos.x, cam_pos.y, cam_pos.z);
+    prog.set_mat3(cam_mat_uni, cam_mat_arr);
+    prog.set_mat3(rot_mat_uni, rot_mat_arr);
 
     // Background texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, bg_tex);
-    glUniform1i(bg_tex_loc, 0);
+    gl_bind_texture(0, bg_tex);
+    prog.set(bg_tex_uni, 0);
 
     // Render
-    glBindFramebuffer(GL_FRAMEBUFFER, render_fbo);
-    glViewport(0, 0, w, h);
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glFinish();
+    RenderPass pass = {render_fbo, vw, vh, output_load(loClear), soStore, true, true};
+    begin_pass(pass);
+    draw_output();
+    end_pass(pass);
 }
 
 void RaySketch::calc_matrices()
@@ -86,15 +74,22 @@ void RaySketch::init()
     bg_tex = create_texture(bg_pixels, bg_w, bg_h);
 }
 
-void RaySketch::unload(double current_time)
+void RaySketch::get_uniforms()
 {
-    glDeleteTextures(1, &bg_tex);
-    bg_tex = 0;
-    FragSketch::unload(current_time);
+    FragSketch::get_uniforms();
+    cam_pos_uni = prog.uniform("camPos");
+    cam_mat_uni = prog.uniform("camMat");
+    rot_mat_uni = prog.uniform("rotMat");
+    bg_tex_uni = prog.uniform("bgTex");
 }
 
-void RaySketch::reload(double current_time)
+size_t RaySketch::gpu_bytes() const
 {
-    // This in turn calls my init() override, so nothing else to do here
-    FragSketch::reload(current_time);
+    return FragSketch::gpu_bytes() + (size_t)bg_w * bg_h * 4;
+}
+
+void RaySketch::unload(double current_time)
+{
+    gl_delete_texture(bg_tex);
+    FragSketch::unload(current_time);
 }
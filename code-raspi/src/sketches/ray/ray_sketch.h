@@ -18,16 +18,23 @@ class RaySketch : public FragSketch
     float cam_mat_arr[9];
     Matrix3 rot_mat;
     float rot_mat_arr[9];
+    ShaderProgram::Uniform cam_pos_uni;
+    ShaderProgram::Uniform cam_mat_uni;
+    ShaderProgram::Uniform rot_mat_uni;
+    ShaderProgram::Uniform bg_tex_uni;
 
   public:
     void calc_matrices();
 
+  protected:
+    void get_uniforms() override;
+
   public:
     RaySketch(int w, int h, GLuint render_fbo);
     void frame(double dt) override;
     void init() override;
     void unload(double current_time) override;
-    void reload(double current_time) override;
+    size_t gpu_bytes() const override;
 };
 
 #endif
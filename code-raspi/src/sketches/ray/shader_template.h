@@ -1,8 +1,9 @@
 #ifndef RAY_SHADERS_H
 #define RAY_SHADERS_H
 
-constexpr const char *ray_frag = R"(
-SRC ray.frag
-)";
+// One per ShaderQuality
+constexpr const char *ray_frag[] = {
+VARIANTS ray.frag
+};
 
 #endif
@@ -0,0 +1,105 @@
+#include "render_pass.h"
+
+// Local dependencies
+#include "bench.h"
+#include "gl_state.h"
+#include "magic.h"
+#include "options.h"
+
+// Global
+#include <GLES3/gl3.h>
+#include <math.h>
+#include <stdint.h>
+
+// Per thread, as passes also run on the compile worker (compile_worker.h): the report covers the render thread
+static thread_local uint64_t traffic_bytes = 0;
+static thread_local uint64_t traffic_bytes_before = 0;
+
+static void invalidate_color(GLuint fbo)
+{
+    // The back buffer names its attachments differently from FBOs
+    const GLenum attachment = fbo == 0 ? GL_COLOR : GL_COLOR_ATTACHMENT0;
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);
+}
+
+static void count_traffic(const RenderPass &pass)
+{
+    // Rough tile memory traffic, ignoring framebuffer compression
+    uint64_t px = (uint64_t)pass.w * pass.h;
+    uint64_t color_bytes = px * (options.rgb565 ? 2 : 4);
+    uint64_t bytes = 0;
+    if (pass.color_load == loLoad) bytes += color_bytes;
+    if (pass.color_store == soStore) bytes += color_bytes;
+    traffic_bytes += bytes;
+
+    // Before: color always stored, plus a depth store (16 bits in FBOs, 24+8 in the EGL surface)
+    uint64_t before = color_bytes + px * (pass.fbo == 0 ? 4 : 2);
+    if (pass.color_load == loLoad) before += color_bytes;
+    traffic_bytes_before += before;
+}
+
+static bool is_full_frame(const int rect[4])
+{
+    return rect[0] == 0 && rect[1] == 0 && rect[2] == W && rect[3] == H;
+}
+
+void get_visible_rect(int w, int h, int rect[4])
+{
+    const int *vr = options.visible_rect;
+    float sx = (float)w / W, sy = (float)h / H;
+    // Round outwards so that scaled-down passes don't lose an edge row or column
+    int x0 = (int)(vr[0] * sx), x1 = (int)ceilf((vr[0] + vr[2]) * sx);
+    int y0 = (int)((H - vr[1] - vr[3]) * sy), y1 = (int)ceilf((H - vr[1]) * sy);
+    rect[0] = x0;
+    rect[1] = y0;
+    rect[2] = x1 - x0;
+    rect[3] = y1 - y0;
+}
+
+void begin_pass(const RenderPass &pass)
+{
+    gl_bind_framebuffer(pass.fbo);
+    gl_viewport(0, 0, pass.w, pass.h);
+
+    // Clearing is free on a tiler: outside the scissor, clear rather than leave garbage
+    bool scissor = pass.visible_only && !is_full_frame(options.visible_rect);
+    LoadOp load = pass.color_load;
+    if (scissor && load == loDontCare) load = loClear;
+
+    // Clear before the scissor, which would restrict it
+    gl_set_enabled(GL_SCISSOR_TEST, false);
+    if (load == loClear)
+    {
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    else if (load == loDontCare) invalidate_color(pass.fbo);
+
+    if (scissor)
+    {
+        int rect[4];
+        get_visible_rect(pass.w, pass.h, rect);
+        gl_scissor(rect[0], rect[1], rect[2], rect[3]);
+        gl_set_enabled(GL_SCISSOR_TEST, true);
+    }
+
+    gl_set_enabled(GL_DEPTH_TEST, false);
+    gl_set_enabled(GL_BLEND, pass.blend);
+    if (pass.blend) gl_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    count_traffic(pass);
+}
+
+void end_pass(const RenderPass &pass)
+{
+    if (pass.color_store == soDiscard) invalidate_color(pass.fbo);
+}
+
+void report_pass_traffic(std::string &out, int frames)
+{
+    const double mb = 1024.0 * 1024.0;
+    bench_appendf(out, "  Attachment traffic: %.2f MB/frame (%.2f MB/frame before invalidation and depth removal)\n",
+                  traffic_bytes / mb / frames,
+                  traffic_bytes_before / mb / frames);
+    traffic_bytes = 0;
+    traffic_bytes_before = 0;
+}
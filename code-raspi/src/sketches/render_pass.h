@@ -0,0 +1,48 @@
+#ifndef RENDER_PASS_H
+#define RENDER_PASS_H
+
+#include <GLES2/gl2.h>
+#include <string>
+
+// What happens to an attachment's tile memory at the start of a pass
+enum LoadOp
+{
+    loLoad,     // Previous contents are needed: read back from memory
+    loClear,    // Cleared to black; nothing is read
+    loDontCare, // Pass covers every pixel it needs; nothing is read or cleared
+};
+
+// ...and at its end
+enum StoreOp
+{
+    soStore,   // Written to memory, e.g. for a later pass to sample
+    soDiscard, // Not needed afterwards; invalidated so nothing is written
+};
+
+// One pass over a framebuffer; fbo 0 is the back buffer.
+// Passes are full-screen quads and don't test depth, so there is only a color attachment.
+struct RenderPass
+{
+    GLuint fbo;
+    int w, h;
+    LoadOp color_load;
+    StoreOp color_store;
+    // Scissor to the part of the frame the CRT shows (options.visible_rect); w x h covers the full frame
+    bool visible_only;
+    // Alpha blending over the cleared or loaded target
+    bool blend;
+};
+
+// Visible part of the frame rendered at w x h, in GL window coordinates (x, y from the bottom left, w, h)
+void get_visible_rect(int w, int h, int rect[4]);
+
+// Binds the framebuffer and viewport, clears or invalidates per color_load, and sets all fixed-function
+// state the pass depends on: blending, scissor, no depth test
+void begin_pass(const RenderPass &pass);
+// Invalidates what isn't stored
+void end_pass(const RenderPass &pass);
+
+// Bench reporter: estimated attachment traffic vs. the previous setup (depth on every target, no hints)
+void report_pass_traffic(std::string &out, int frames);
+
+#endif
@@ -0,0 +1,13 @@
+#version 310 es
+precision mediump float;
+
+// Keeps the checkerboard cells of this phase: 2 x 2 pixels each, so that GPU quads are whole
+uniform int phase;
+
+out vec4 fragColor;
+
+void main() {
+    ivec2 cell = ivec2(gl_FragCoord.xy) / 2;
+    if (((cell.x + cell.y) & 1) != phase) discard;
+    fragColor = vec4(0.0);
+}
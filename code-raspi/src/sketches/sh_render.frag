@@ -5,6 +5,16 @@ uniform sampler2D tex;
 uniform vec2 resolution;
 uniform float time;
 uniform float sketchStrength;
+uniform vec2 texScale;
+uniform float dither;
+uniform sampler2D overlayTex;
+uniform vec4 overlayRect;
+uniform float overlayOn;
+uniform float staticMix;
+uniform sampler2D prevTex;
+uniform vec2 prevTexScale;
+uniform float prevMix;
+uniform float checkerPhase;
 
 out vec4 fragColor;
 
@@ -20,6 +30,34 @@ vec3 whiteNoise(vec2 uv) {
     return nz * 0.5;
 }
 
+// Checkerboard rendering (checker_mask.h): only the 2 x 2 texel cells of checkerPhase are from this frame.
+// The others are from the frame before, clamped to the range of their fresh neighbours so that motion
+// doesn't leave a ghost.
+vec3 sketchColor(vec2 tc) {
+    vec3 c = texture(tex, tc).rgb;
+    if (checkerPhase < 0.0) return c;
+    vec2 texSize = vec2(textureSize(tex, 0));
+    vec2 cell = floor(tc * texSize / 2.0);
+    if (mod(cell.x + cell.y, 2.0) == checkerPhase) return c;
+    vec2 d = 2.0 / texSize;
+    vec3 l = texture(tex, tc - vec2(d.x, 0.0)).rgb;
+    vec3 r = texture(tex, tc + vec2(d.x, 0.0)).rgb;
+    vec3 b = texture(tex, tc - vec2(0.0, d.y)).rgb;
+    vec3 t = texture(tex, tc + vec2(0.0, d.y)).rgb;
+    return clamp(c, min(min(l, r), min(b, t)), max(max(l, r), max(b, t)));
+}
+
+// 4x4 Bayer matrix threshold in [0, 1)
+float bayer4(vec2 p) {
+    const float m[16] = float[16](
+        0.0, 8.0, 2.0, 10.0,
+        12.0, 4.0, 14.0, 6.0,
+        3.0, 11.0, 1.0, 9.0,
+        15.0, 7.0, 13.0, 5.0);
+    ivec2 i = ivec2(mod(p, 4.0));
+    return m[i.y * 4 + i.x] / 16.0;
+}
+
 void main() {
     fragColor.a = 1.0;
     vec2 uv = gl_FragCoord.xy / resolution;
@@ -27,5 +65,23 @@ void main() {
     if(sketchStrength == 0.0)
         fragColor.rgb = whiteNoise(uv);
     else
-        fragColor.rgb = texture(tex, uv).rgb * sketchStrength;
+    {
+        vec3 sketch = sketchColor(uv * texScale);
+        // Between the frames of a station rendering at a fraction of the frame rate
+        if (prevMix > 0.0)
+            sketch = mix(sketch, texture(prevTex, uv * prevTexScale).rgb, prevMix);
+        fragColor.rgb = sketch * sketchStrength + whiteNoise(uv) * staticMix;
+    }
+
+    // Overlay image rows are top to bottom
+    vec2 ouv = (gl_FragCoord.xy - overlayRect.xy) / overlayRect.zw;
+    if (overlayOn > 0.0 && all(greaterThanEqual(ouv, vec2(0.0))) && all(lessThan(ouv, vec2(1.0))))
+    {
+        vec4 ov = texture(overlayTex, vec2(ouv.x, 1.0 - ouv.y));
+        fragColor.rgb = mix(fragColor.rgb, ov.rgb, ov.a);
+    }
+
+    // Spread quantization error of the 5/6/5-bit output into a fixed pattern instead of bands
+    if (dither > 0.0)
+        fragColor.rgb += (bayer4(gl_FragCoord.xy) - 0.5) * vec3(1.0 / 31.0, 1.0 / 63.0, 1.0 / 31.0);
 }
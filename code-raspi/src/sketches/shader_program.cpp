@@ -0,0 +1,168 @@
+#include "shader_program.h"
+
+// Local dependencies
+#include "error.h"
+#include "gl_state.h"
+#include "gpu_resources.h"
+#include "program_cache.h"
+#include "sketch_base.h"
+
+// Global
+#include <GLES3/gl3.h>
+#include <string.h>
+
+void ShaderProgram::build(const char *vert_src, const char *frag_src)
+{
+    release();
+    uint64_t key = program_cache_key(vert_src, frag_src);
+    prog = load_cached_program(key);
+    if (prog == 0)
+    {
+        link(vert_src, frag_src);
+        store_cached_program(key, prog);
+    }
+    GLint len = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+    binary_bytes = len;
+    get_uniforms();
+}
+
+void ShaderProgram::link(const char *vert_src, const char *frag_src)
+{
+    vs = acquire_shader(GL_VERTEX_SHADER, vert_src);
+    fs = acquire_shader(GL_FRAGMENT_SHADER, frag_src);
+
+    // Link program, with position attribute
+    prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    const GLint ixPosAttribute = 0;
+    glBindAttribLocation(prog, ixPosAttribute, "position");
+    prepare_cached_program(prog);
+    glLinkProgram(prog);
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        GLuint failed = prog;
+        prog = 0;
+        SketchBase::throw_shader_link_error(failed);
+    }
+}
+
+void ShaderProgram::get_uniforms()
+{
+    // All active uniforms; array names come back as "name[0]"
+    GLint count = 0, max_len = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
+    std::vector<char> name(max_len + 1);
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(prog, i, max_len + 1, nullptr, &size, &type, &name[0]);
+        char *bracket = strchr(&name[0], '[');
+        if (bracket) *bracket = '\0';
+        Slot s = {};
+        s.name = &name[0];
+        s.location = glGetUniformLocation(prog, &name[0]);
+        s.type = type;
+        slots.push_back(s);
+    }
+}
+
+void ShaderProgram::release()
+{
+    gl_delete_program(prog);
+    binary_bytes = 0;
+    release_shader(fs);
+    release_shader(vs);
+    slots.clear();
+}
+
+void ShaderProgram::use()
+{
+    gl_use_program(prog);
+}
+
+ShaderProgram::Uniform ShaderProgram::uniform(const char *name) const
+{
+    Uniform u;
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        if (slots[i].name == name)
+        {
+            u.ix = (int)i;
+            break;
+        }
+    }
+    return u;
+}
+
+ShaderProgram::Slot *ShaderProgram::slot(Uniform u, GLenum type)
+{
+    if (u.ix < 0 || u.ix >= (int)slots.size()) return nullptr;
+    Slot &s = slots[u.ix];
+    bool sampler = s.type == GL_SAMPLER_2D || s.type == GL_SAMPLER_CUBE;
+    if (s.type != type && !(type == GL_INT && sampler))
+        THROWF("Uniform '%s' has type 0x%04X, set as 0x%04X", s.name.c_str(), (int)s.type, (int)type);
+    return &s;
+}
+
+bool ShaderProgram::float_changed(Slot &s, const GLfloat *v, int n)
+{
+    if (s.has_value && memcmp(s.value, v, n * sizeof(GLfloat)) == 0) return false;
+    memcpy(s.value, v, n * sizeof(GLfloat));
+    s.has_value = true;
+    return true;
+}
+
+void ShaderProgram::set(Uniform u, float x)
+{
+    Slot *s = slot(u, GL_FLOAT);
+    if (!s || !float_changed(*s, &x, 1)) return;
+    glUniform1f(s->location, x);
+}
+
+void ShaderProgram::set(Uniform u, float x, float y)
+{
+    Slot *s = slot(u, GL_FLOAT_VEC2);
+    GLfloat v[2] = {x, y};
+    if (!s || !float_changed(*s, v, 2)) return;
+    glUniform2f(s->location, x, y);
+}
+
+void ShaderProgram::set(Uniform u, float x, float y, float z)
+{
+    Slot *s = slot(u, GL_FLOAT_VEC3);
+    GLfloat v[3] = {x, y, z};
+    if (!s || !float_changed(*s, v, 3)) return;
+    glUniform3f(s->location, x, y, z);
+}
+
+void ShaderProgram::set(Uniform u, float x, float y, float z, float w)
+{
+    Slot *s = slot(u, GL_FLOAT_VEC4);
+    GLfloat v[4] = {x, y, z, w};
+    if (!s || !float_changed(*s, v, 4)) return;
+    glUniform4f(s->location, x, y, z, w);
+}
+
+void ShaderProgram::set(Uniform u, int x)
+{
+    Slot *s = slot(u, GL_INT);
+    if (!s || (s->has_value && s->int_value == x)) return;
+    s->int_value = x;
+    s->has_value = true;
+    glUniform1i(s->location, x);
+}
+
+void ShaderProgram::set_mat3(Uniform u, const float *m)
+{
+    Slot *s = slot(u, GL_FLOAT_MAT3);
+    if (!s || !float_changed(*s, m, 9)) return;
+    // ES 2 has no transpose flag: upload column-major
+    GLfloat cm[9] = {m[0], m[3], m[6], m[1], m[4], m[7], m[2], m[5], m[8]};
+    glUniformMatrix3fv(s->location, 1, GL_FALSE, cm);
+}
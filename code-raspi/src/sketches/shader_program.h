@@ -0,0 +1,63 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <GLES2/gl2.h>
+#include <string>
+#include <vector>
+
+// Linked program whose active uniforms are resolved once, at link time.
+// Setters skip the glUniform* call if the uniform already has that value.
+class ShaderProgram
+{
+  public:
+    // Handle to an active uniform; a default one (e.g. for a name the program doesn't use) is ignored by setters
+    struct Uniform
+    {
+        int ix = -1;
+    };
+
+  private:
+    struct Slot
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        bool has_value;
+        GLfloat value[9];
+        GLint int_value;
+    };
+    GLuint vs = 0;
+    GLuint fs = 0;
+    GLuint prog = 0;
+    size_t binary_bytes = 0;
+    std::vector<Slot> slots;
+
+  private:
+    void link(const char *vert_src, const char *frag_src);
+    void get_uniforms();
+    Slot *slot(Uniform u, GLenum type);
+    bool float_changed(Slot &s, const GLfloat *v, int n);
+
+  public:
+    // Loads the program binary cache's copy, or links the shared compiled shaders and stores the result.
+    // Attribute 0 is bound to "position". Throws on errors.
+    void build(const char *vert_src, const char *frag_src);
+    void release();
+    GLuint id() const { return prog; }
+    // Driver's size of the linked program; an estimate of its GPU memory
+    size_t bytes() const { return binary_bytes; }
+    // Makes the program current; setters apply to the current program
+    void use();
+    Uniform uniform(const char *name) const;
+
+    void set(Uniform u, float x);
+    void set(Uniform u, float x, float y);
+    void set(Uniform u, float x, float y, float z);
+    void set(Uniform u, float x, float y, float z, float w);
+    // Ints and samplers
+    void set(Uniform u, int x);
+    // Row-major 3x3
+    void set_mat3(Uniform u, const float *m);
+};
+
+#endif
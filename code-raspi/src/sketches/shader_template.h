@@ -13,4 +13,8 @@ constexpr const char *static_frag = R"(
 SRC ./sh_static.frag
 )";
 
+constexpr const char *checker_frag = R"(
+SRC ./sh_checker.frag
+)";
+
 #endif
@@ -1,8 +1,11 @@
 #include "sketch_base.h"
 
 // Local dependencies
+#include "checker_mask.h"
 #include "error.h"
 #include "file_helpers.h"
+#include "gl_state.h"
+#include "options.h"
 
 // Lib
 #include "../lib/lodepng.h"
@@ -12,15 +15,36 @@
 #include <memory>
 #include <unistd.h>
 
-SketchBase::SketchBase()
+SketchBase::SketchBase(int w, int h, GLuint render_fbo)
+    : w(w)
+    , h(h)
+    , render_fbo(render_fbo)
+    , vw(w)
+    , vh(h)
 {
-    // "Sweep" vertex shader's two fixed triangles
-    fill_quad(quad);
 }
 
-void SketchBase::fill_quad(std::vector<GLfloat> &quad)
+void SketchBase::set_render_scale(float scale)
 {
-    quad.assign({-1, -1, 1, -1, -1, 1, -1, 1, 1, -1, 1, 1});
+    vw = (int)(w * scale + 0.5f);
+    vh = (int)(h * scale + 0.5f);
+    if (vw < 1) vw = 1;
+    if (vh < 1) vh = 1;
+}
+
+void SketchBase::draw_output()
+{
+    if (checker >= 0) begin_checker_mask(checker);
+    if (field < 0) glDrawArrays(GL_TRIANGLES, 0, 6);
+    else field_mesh.draw(field, vh);
+    if (checker >= 0) end_checker_mask();
+}
+
+void SketchBase::set_visible_rect_uniform(ShaderProgram &prog, ShaderProgram::Uniform visible_rect)
+{
+    int rect[4];
+    get_visible_rect(vw, vh, rect);
+    prog.set(visible_rect, (float)rect[0], (float)rect[1], (float)rect[2], (float)rect[3]);
 }
 
 GLuint SketchBase::compile_shader(GLenum type, const char *src)
@@ -75,36 +99,36 @@ GLuint SketchBase::create_texture(uint8_t *px_arr, unsigned w, unsigned h)
 {
     GLuint tex;
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    gl_bind_texture_for_edit(0, tex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, px_arr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     return tex;
 }
 
-void SketchBase::create_target_texture(unsigned w, unsigned h, GLuint &tex, GLuint &fbo, GLuint &depth)
+size_t SketchBase::target_texture_bytes(unsigned w, unsigned h)
 {
-    // Texture
+    return (size_t)w * h * (options.rgb565 ? 2 : 4);
+}
+
+void SketchBase::create_target_texture(unsigned w, unsigned h, GLuint &tex, GLuint &fbo)
+{
+    // Texture; RGB565 halves the bandwidth of every pass that reads or writes it
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl_bind_texture_for_edit(0, tex);
+    if (options.rgb565) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, nullptr);
+    else glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     // Framebuffer and attach texture
     glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gl_bind_framebuffer(fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
 
-    // Depth buffer
-    glGenRenderbuffers(1, &depth);
-    glBindRenderbuffer(GL_RENDERBUFFER, depth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, w, h);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
-
     GLenum res = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (res != GL_FRAMEBUFFER_COMPLETE)
         THROWF("Render target FBO failed to build: 0x%04X", (int)res);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl_bind_framebuffer(0);
 }
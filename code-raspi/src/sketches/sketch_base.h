@@ -1,18 +1,49 @@
 #ifndef SKETCH_IF_H
 #define SKETCH_IF_H
 
+#include "field_mesh.h"
+#include "render_pass.h"
+#include "shader_program.h"
+
 #include <GLES2/gl2.h>
 #include <vector>
 
+// Cost of a sketch's shaders: QUALITY in shaders pasted with VARIANTS (make_shaders.sh)
+enum ShaderQuality
+{
+    sqLow,
+    sqMedium,
+    sqHigh,
+    sqCount,
+};
+
 class SketchBase
 {
   protected:
-    std::vector<GLfloat> quad;
+    // Full size of the target we render into
+    const int w, h;
+    // Where the final pass renders: RenderBlender's target, or 0 (the back buffer) in pass-through
+    GLuint render_fbo;
+    // Size actually rendered, anchored at the target's bottom left; smaller than w x h when scaled down
+    int vw, vh;
+    // Interlaced rendering: field the final pass shades, leaving the other field's rows as they are; -1 for all rows
+    int field = -1;
+    FieldMesh field_mesh;
+    // Checkerboard rendering: phase of the cells the final pass shades (checker_mask.h), or -1 for all
+    int checker = -1;
+
+  protected:
+    // Final pass load op: a field or checkerboard pass must keep the other half of the target
+    LoadOp output_load(LoadOp full_frame) const { return field < 0 && checker < 0 ? full_frame : loLoad; }
+    // Draws the final pass: the sweep quad, the current field's rows, or the current checkerboard cells
+    void draw_output();
+    // Sets a "visibleRect" uniform: the part of the vw x vh output the CRT shows, in gl_FragCoord pixels.
+    // Shaders center their composition on it.
+    void set_visible_rect_uniform(ShaderProgram &prog, ShaderProgram::Uniform visible_rect);
 
   public:
     static GLuint compile_shader(GLenum type, const char *src);
     static void throw_shader_link_error(GLuint prog);
-    static void fill_quad(std::vector<GLfloat> &quad);
 
     // Loads and decodes PNG; looks for file in directory of executable.
     static void load_png(uint8_t **px_arr, unsigned int *img_w, unsigned int *img_h, const char *fn);
@@ -20,15 +51,34 @@ class SketchBase
     // Creates texture and fills with pixel data
     static GLuint create_texture(uint8_t *px_arr, unsigned w, unsigned h);
 
-    // Creates a target texture and FBO for interim rendering
-    static void create_target_texture(unsigned w, unsigned h, GLuint &tex, GLuint &fbo, GLuint &depth);
+    // Creates a target texture and FBO for interim rendering; color only, as no pass tests depth
+    static void create_target_texture(unsigned w, unsigned h, GLuint &tex, GLuint &fbo);
+    // Size of a texture made by create_target_texture
+    static size_t target_texture_bytes(unsigned w, unsigned h);
 
   public:
-    SketchBase();
+    SketchBase(int w, int h, GLuint render_fbo);
+    void set_render_scale(float scale);
+    void set_target(GLuint fbo) { render_fbo = fbo; }
+    void set_field(int field) { this->field = field; }
+    void set_checker(int checker) { this->checker = checker; }
+    int render_w() const { return vw; }
+    int render_h() const { return vh; }
+    // Creates programs, textures and buffers. May run on the compile worker's thread (compile_worker.h),
+    // whose context shares those with the render thread's context, but not FBOs: create them in start().
     virtual void init() = 0;
+    // On the render thread after init, each time the station is tuned in: restarts the clock
+    virtual void start(double current_time) {};
     virtual void frame(double dt) = 0;
+    // On the render thread once started: switches to shaders of another cost, if the sketch has variants.
+    // A load starts at sqHigh.
+    virtual void set_quality(ShaderQuality quality) {};
+    // Whether set_quality changes anything; known from construction
+    virtual bool has_quality_variants() const { return false; }
+    // On the render thread: deletes what init and start created
     virtual void unload(double current_time) {};
-    virtual void reload(double current_time) {};
+    // GPU memory the sketch holds once loaded and started, for the residency budget (residency.h)
+    virtual size_t gpu_bytes() const = 0;
     virtual ~SketchBase() = default;
 };
 
@@ -1,89 +1,113 @@
 #include "sketch_frag.h"
 
+#include "gl_state.h"
+#include "gpu_resources.h"
 #include "horrors.h"
+#include "render_pass.h"
 
 // GLSL
 #include "shaders.h"
 
 // Global
 #include <cstdio>
+#include <utility>
 
 FragSketch::FragSketch(int w, int h, GLuint render_fbo, const char *frag)
-    : w(w)
-    , h(h)
-    , render_fbo(render_fbo)
-    , frag(frag)
+    : SketchBase(w, h, render_fbo)
+    , vert(sweep_vert)
     , time(0)
 {
+    for (int q = 0; q < sqCount; ++q)
+        frags[q] = frag;
+}
+
+FragSketch::FragSketch(int w, int h, GLuint render_fbo, const char *const *frags, const char *vert)
+    : SketchBase(w, h, render_fbo)
+    , vert(vert ? vert : sweep_vert)
+    , time(0)
+{
+    for (int q = 0; q < sqCount; ++q)
+        this->frags[q] = frags[q];
 }
 
 void FragSketch::init()
 {
-    // Compile shaders
-    vs = compile_shader(GL_VERTEX_SHADER, sweep_vert);
-    fs = compile_shader(GL_FRAGMENT_SHADER, frag);
-
-    // Link program, with position attribute
-    prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    const GLint ixPosAttribute = 0;
-    glBindAttribLocation(prog, ixPosAttribute, "position");
-    glLinkProgram(prog);
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) throw_shader_link_error(prog);
-
-    // OpenGL fidgeting
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    // Array buffer: for vertex array
-    glGenBuffers(1, &vbo);
+    quality = sqHigh;
+    prog.build(vert, frags[quality]);
+    for (int q = 0; q < sqCount; ++q)
+    {
+        if (q != quality && frags[q] != frags[quality]) other_progs[q].build(vert, frags[q]);
+    }
+    get_uniforms();
+}
+
+void FragSketch::get_uniforms()
+{
+    get_common_uniforms();
+}
+
+void FragSketch::set_quality(ShaderQuality quality)
+{
+    if (quality == this->quality || other_progs[quality].id() == 0) return;
+    std::swap(prog, other_progs[this->quality]);
+    std::swap(prog, other_progs[quality]);
+    this->quality = quality;
+    get_uniforms();
+}
+
+bool FragSketch::has_quality_variants() const
+{
+    for (int q = 0; q < sqCount; ++q)
+        if (frags[q] != frags[sqHigh]) return true;
+    return false;
+}
+
+void FragSketch::get_common_uniforms()
+{
+    time_uni = prog.uniform("time");
+    resolution_uni = prog.uniform("resolution");
+    visible_rect_uni = prog.uniform("visibleRect");
+}
+
+void FragSketch::set_common_uniforms()
+{
+    prog.set(time_uni, (float)time);
+    prog.set(resolution_uni, (float)vw, (float)vh);
+    set_visible_rect_uniform(prog, visible_rect_uni);
 }
 
 void FragSketch::frame(double dt)
 {
     time += dt;
 
-    glUseProgram(prog);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    // This is redundant, but it's what we'll need if attributes change frame-by-frame
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * quad.size(), &quad[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    prog.use();
 
-    GLint time_loc = glGetUniformLocation(prog, "time");
-    GLint resolution_loc = glGetUniformLocation(prog, "resolution");
+    gl_bind_vertex_array(quad_vao());
 
-    glUniform1f(time_loc, (float)time);
-    glUniform2f(resolution_loc, (float)w, (float)h);
+    set_common_uniforms();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, render_fbo);
-    glViewport(0, 0, w, h);
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glFinish();
+    RenderPass pass = {render_fbo, vw, vh, output_load(loClear), soStore, true, true};
+    begin_pass(pass);
+    draw_output();
+    end_pass(pass);
 }
 
 void FragSketch::unload(double current_time)
 {
-    glDeleteBuffers(1, &vbo);
-    vbo = 0;
-    glDeleteProgram(prog);
-    prog = 0;
-    glDeleteShader(fs);
-    fs = 0;
-    glDeleteShader(vs);
-    vs = 0;
+    prog.release();
+    for (int q = 0; q < sqCount; ++q)
+        other_progs[q].release();
+}
+
+size_t FragSketch::gpu_bytes() const
+{
+    size_t bytes = prog.bytes();
+    for (int q = 0; q < sqCount; ++q)
+        bytes += other_progs[q].bytes();
+    return bytes;
 }
 
-void FragSketch::reload(double current_time)
+void FragSketch::start(double current_time)
 {
     time = current_time;
-    init();
 }
@@ -1,26 +1,44 @@
 #ifndef SKETCH_FRAG_H
 #define SKETCH_FRAG_H
 
+#include "shader_program.h"
 #include "sketch_base.h"
 
 class FragSketch : public SketchBase
 {
   protected:
-    const int w, h;
-    const GLuint render_fbo;
-    const char *frag;
-    GLuint vs = 0;
-    GLuint fs = 0;
-    GLuint prog = 0;
-    GLuint vbo = 0;
+    const char *vert;
+    // Per ShaderQuality; all the same for a sketch without variants
+    const char *frags[sqCount];
+    ShaderQuality quality = sqHigh;
+    // Program of the current quality
+    ShaderProgram prog;
+    // The other qualities' programs, all built by init so that switching is instant; the current one's is empty
+    ShaderProgram other_progs[sqCount];
+    ShaderProgram::Uniform time_uni;
+    ShaderProgram::Uniform resolution_uni;
+    ShaderProgram::Uniform visible_rect_uni;
     double time;
 
+  protected:
+    // Looks up the uniforms every FragSketch shader may have
+    void get_common_uniforms();
+    // Looks up prog's uniforms, after init and after each quality switch. Overrides call this one first.
+    virtual void get_uniforms();
+    // Sets time, resolution and visibleRect; prog must be current
+    void set_common_uniforms();
+
   public:
     FragSketch(int w, int h, GLuint render_fbo, const char *frag);
+    // frags has an entry per ShaderQuality; vert defaults to the sweep quad's
+    FragSketch(int w, int h, GLuint render_fbo, const char *const *frags, const char *vert = nullptr);
     virtual void init() override;
+    virtual void start(double current_time) override;
     virtual void frame(double dt) override;
+    virtual void set_quality(ShaderQuality quality) override;
+    virtual bool has_quality_variants() const override;
     virtual void unload(double current_time) override;
-    virtual void reload(double current_time) override;
+    virtual size_t gpu_bytes() const override;
 };
 
 #endif
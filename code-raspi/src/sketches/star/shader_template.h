@@ -1,8 +1,9 @@
 #ifndef STAR_SHADERS_H
 #define STAR_SHADERS_H
 
-constexpr const char *star_frag = R"(
-SRC star.frag
-)";
+// One per ShaderQuality
+constexpr const char *star_frag[] = {
+VARIANTS star.frag
+};
 
 #endif
@@ -2,9 +2,10 @@
 precision highp float;
 uniform float time;
 uniform vec2 resolution;
+uniform vec4 visibleRect;
 out vec4 fragColor;
 vec2 uvN(){ return gl_FragCoord.xy / resolution; }
-vec2 uv(){ return (gl_FragCoord.xy / resolution * 2.0 - 1.0) * vec2(resolution.x/resolution.y, 1.0); }
+vec2 uv(){ return ((gl_FragCoord.xy - visibleRect.xy - visibleRect.zw * 0.5) / resolution * 2.0) * vec2(resolution.x/resolution.y, 1.0); }
 #define rot(a) mat2(-1.+2.*noise(a), -sin(a), sin(a), -1.+2.*noise(a))
 #define f(z,a) (manualInverse(z)*.15 - a*z)
 float rand(const in float n){return fract(sin(n) * 1e4);}
@@ -25,9 +26,14 @@ vec4 star(vec2 u) {
                 3.21+length(u)*3.83
                 )), 1.);
 }
+#if QUALITY == 0
+#define FOLDS 2
+#else
+#define FOLDS 3
+#endif
 void main() {
     vec2 u = uv();
-    for (int i=0;i++<3;)
+    for (int i=0;i++<FOLDS;)
         u=vec2(u.x,-u.y)/dot(u,u)+.4*u*rot(time*.05);
 //    u/= length(u);
     u = normalize(u)*log(length(u));
@@ -0,0 +1,190 @@
+#include "thermal_monitor.h"
+
+// Local dependencies
+#include "bench.h"
+#include "error.h"
+#include "lock.h"
+#include "options.h"
+
+// Global
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Levels are entered at these temperatures and left hysteresis below them, in millidegrees C
+static const int warm_mc = 72000;
+static const int hot_mc = 77000;
+static const int hysteresis_mc = 3000;
+static const int poll_interval_sec = 1;
+
+static const char *level_names[] = {"normal", "warm", "hot"};
+
+// Last readings, for the bench report; guarded by stats_mut
+static pthread_mutex_t stats_mut = PTHREAD_MUTEX_INITIALIZER;
+static int last_mc = -1;
+static int period_peak_mc = -1;
+static int cpu_khz = 0;
+static int cpu_max_khz = 0;
+static ThermalLevel reported_level = tlNormal;
+
+// Reads a file holding one integer, like most of sysfs; false if it can't be read
+static bool read_int(const std::string &path, int &value)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    bool ok = fscanf(f, "%d", &value) == 1;
+    fclose(f);
+    return ok;
+}
+
+// Throttling flags the firmware reports: frequency capped, throttled, or soft temperature limit active, now
+static const unsigned int fw_throttled_now = 0xe;
+
+// Whether the firmware throttles the SoC right now; false where it doesn't tell
+static bool read_fw_throttled(const std::string &root)
+{
+    FILE *f = fopen((root + "/devices/platform/soc/soc:firmware/get_throttled").c_str(), "r");
+    if (!f) return false;
+    unsigned int flags = 0;
+    bool ok = fscanf(f, "%x", &flags) == 1;
+    fclose(f);
+    return ok && (flags & fw_throttled_now) != 0;
+}
+
+// Hottest of all thermal zones, or -1 if none can be read
+static int read_max_temp(const std::string &root)
+{
+    std::string dir = root + "/class/thermal";
+    DIR *d = opendir(dir.c_str());
+    if (!d) return -1;
+    int max_mc = -1;
+    while (dirent *e = readdir(d))
+    {
+        if (strncmp(e->d_name, "thermal_zone", 12) != 0) continue;
+        int mc;
+        if (read_int(dir + "/" + e->d_name + "/temp", mc) && mc > max_mc) max_mc = mc;
+    }
+    closedir(d);
+    return max_mc;
+}
+
+static void log_event(const char *what, int mc, int khz, int max_khz)
+{
+    char stamp[32];
+    time_t now = time(nullptr);
+    tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+    printf("\n%s Thermal: %.1f C, CPU %d of %d MHz: %s\n", stamp, mc / 1000.0, khz / 1000, max_khz / 1000, what);
+}
+
+ThermalMonitor::ThermalMonitor()
+{
+    int r = pthread_mutex_init(&mut, NULL);
+    if (r != 0) THROWF("Failed to initialize mutex: %d: %s", r, strerror(r));
+    r = pthread_cond_init(&cond, NULL);
+    if (r != 0) THROWF("Failed to initialize condition variable: %d: %s", r, strerror(r));
+
+    if (!poll())
+    {
+        printf("No thermal zones under %s; not watching temperature.\n", options.sysfs_root.c_str());
+        return;
+    }
+    r = pthread_create(&thread, NULL, loop, this);
+    if (r != 0) THROWF("Failed to create thread: %d: %s", r, strerror(r));
+    thread_running = true;
+}
+
+ThermalMonitor::~ThermalMonitor()
+{
+    if (thread_running)
+    {
+        {
+            Lock lock(&mut);
+            quitting = true;
+            pthread_cond_signal(&cond);
+        }
+        pthread_join(thread, NULL);
+    }
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mut);
+}
+
+bool ThermalMonitor::poll()
+{
+    const std::string &root = options.sysfs_root;
+    int mc = read_max_temp(root);
+    if (mc < 0) return false;
+
+    // A scaling_max_freq that dropped while running means a cooling device capped the clock
+    int khz = 0, max_khz = 0, cap_khz = 0;
+    std::string cpufreq = root + "/devices/system/cpu/cpu0/cpufreq/";
+    read_int(cpufreq + "scaling_cur_freq", khz);
+    read_int(cpufreq + "cpuinfo_max_freq", max_khz);
+    bool has_cap = read_int(cpufreq + "scaling_max_freq", cap_khz);
+    bool fw_throttled = read_fw_throttled(root);
+
+    Lock lock(&mut);
+    if (start_cap_khz < 0 && has_cap) start_cap_khz = cap_khz;
+    bool capped = fw_throttled || (has_cap && cap_khz < start_cap_khz);
+
+    // Throttling holds the level at hot; it's left like for temperature, hysteresis below hot
+    ThermalLevel level = current;
+    if (capped || mc >= hot_mc) level = tlHot;
+    else if (level == tlHot && mc < hot_mc - hysteresis_mc) level = mc >= warm_mc ? tlWarm : tlNormal;
+    else if (level == tlWarm && mc < warm_mc - hysteresis_mc) level = tlNormal;
+    else if (level == tlNormal && mc >= warm_mc) level = tlWarm;
+
+    if (level != current)
+    {
+        std::string what = std::string(level_names[current]) + " -> " + level_names[level];
+        if (capped) what += ", CPU throttled";
+        log_event(what.c_str(), mc, khz, max_khz);
+        current = level;
+    }
+
+    Lock stats_lock(&stats_mut);
+    last_mc = mc;
+    if (mc > period_peak_mc) period_peak_mc = mc;
+    cpu_khz = khz;
+    cpu_max_khz = max_khz;
+    reported_level = level;
+    return true;
+}
+
+void *ThermalMonitor::loop(void *arg)
+{
+    ThermalMonitor *self = (ThermalMonitor *)arg;
+    while (true)
+    {
+        {
+            Lock lock(&self->mut);
+            timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_sec += poll_interval_sec;
+            while (!self->quitting)
+                if (pthread_cond_timedwait(&self->cond, &self->mut, &until) == ETIMEDOUT) break;
+            if (self->quitting) break;
+        }
+        // Zones can go away, e.g. on a fake tree; keep the last level rather than guess
+        self->poll();
+    }
+    return nullptr;
+}
+
+ThermalLevel ThermalMonitor::level()
+{
+    Lock lock(&mut);
+    return current;
+}
+
+void ThermalMonitor::report(std::string &out, int frames)
+{
+    Lock lock(&stats_mut);
+    if (last_mc < 0) return;
+    bench_appendf(out, "  Thermal: %.1f C, peak %.1f C; CPU %d of %d MHz; %s\n", last_mc / 1000.0,
+                  period_peak_mc / 1000.0, cpu_khz / 1000, cpu_max_khz / 1000, level_names[reported_level]);
+    period_peak_mc = last_mc;
+}
@@ -0,0 +1,44 @@
+#ifndef THERMAL_MONITOR_H
+#define THERMAL_MONITOR_H
+
+#include <pthread.h>
+#include <string>
+
+enum ThermalLevel
+{
+    tlNormal,
+    tlWarm, // Getting close to the throttle point: shed some load
+    tlHot,  // Just below it, or the CPU is already throttled: shed as much as possible
+};
+
+// Watches SoC temperature, CPU frequency caps and the firmware's throttling flags under options.sysfs_root,
+// on a thread of its own that polls once a second, and logs changes of level with a timestamp. The Pi 4
+// firmware throttles silently at 80 C; the levels are meant to make the receiver cut back before it gets there.
+class ThermalMonitor
+{
+  private:
+    pthread_t thread;
+    bool thread_running = false;
+    pthread_mutex_t mut;
+    pthread_cond_t cond;
+    bool quitting = false;
+    ThermalLevel current = tlNormal;
+    // scaling_max_freq at startup: a user's cap there isn't thermal, only a lower one is
+    int start_cap_khz = -1;
+
+  private:
+    static void *loop(void *arg);
+    // Reads sysfs and updates the level; false if there is no temperature to read
+    bool poll();
+
+  public:
+    ThermalMonitor();
+    ~ThermalMonitor();
+    // Any thread
+    ThermalLevel level();
+
+    // Bench reporter: temperature, CPU clock and level
+    static void report(std::string &out, int frames);
+};
+
+#endif
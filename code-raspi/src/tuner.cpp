@@ -6,13 +6,19 @@
 
 // Global
 #include <algorithm>
+#include <limits.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
 
 static const int tuned_enter = 2;
 static const int tuned_leave = 6;
 static const int near_enter = 12;
 static const int near_leave = 16;
+// Smoothing of the motion estimate per update; readings come every HWCTRL_CYCLE_MSEC and are jittery
+static const double motion_smoothing = 0.25;
+// Below this speed (values per second) the knob is taken to be still
+static const double min_speed = 15;
 
 Tuner::Tuner(bool debug_log)
     : debug_log(debug_log)
@@ -51,16 +57,55 @@ void Tuner::get_status(int &ix, TuneStatus &status)
     status = station_status;
 }
 
+int Tuner::predict_station(double lookahead)
+{
+    Lock lock(&mut);
+
+    if (station_vals.size() == 0 || fabs(velocity) < min_speed) return -1;
+
+    // Acceleration only brakes or speeds up the motion; it doesn't turn the knob around
+    double travel = velocity * lookahead + 0.5 * acceleration * lookahead * lookahead;
+    if (travel * velocity < 0) travel = 0;
+    double val = last_val + travel;
+
+    int ix = -1;
+    double dist = 0;
+    for (int i = 0; i < (int)station_vals.size(); ++i)
+    {
+        double dist_here = fabs(station_vals[i] - val);
+        if (ix == -1 || dist_here < dist) ix = i, dist = dist_here;
+    }
+    return ix == station_ix ? -1 : ix;
+}
+
+void Tuner::update_motion(int val)
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = ts.tv_sec + ts.tv_nsec * 1e-9;
+    if (last_time >= 0 && now > last_time)
+    {
+        double dt = now - last_time;
+        double new_velocity = velocity + motion_smoothing * ((val - last_val) / dt - velocity);
+        acceleration += motion_smoothing * ((new_velocity - velocity) / dt - acceleration);
+        velocity = new_velocity;
+    }
+    last_time = now;
+    last_val = val;
+}
+
 void Tuner::update(int val)
 {
     Lock lock(&mut);
 
     val = smooth_reading(val);
+    update_motion(val);
 
     if (station_vals.size() == 0) return;
 
-    int station_val = station_vals[station_ix];
-    int station_dist = abs(station_val - val);
+    // No station yet: the nearest one is taken below
+    int station_val = station_ix == -1 ? val : station_vals[station_ix];
+    int station_dist = station_ix == -1 ? INT_MAX : abs(station_val - val);
 
     // Find nearest station
     int ix = -1;
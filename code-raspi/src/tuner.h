@@ -19,9 +19,15 @@ class Tuner : public IValueListener
     int val_ix = 0;
     int station_ix = -1;
     TuneStatus station_status = tsNone;
+    // Knob motion, smoothed: values per second, and per second squared
+    double last_time = -1;
+    int last_val = 0;
+    double velocity = 0;
+    double acceleration = 0;
 
   private:
     int smooth_reading(int val);
+    void update_motion(int val);
 
   public:
     static int val_to_freq(int val);
@@ -30,6 +36,9 @@ class Tuner : public IValueListener
     void update(int val) override;
     void add_station(int freq);
     void get_status(int &ix, TuneStatus &status);
+    // Station the knob will be nearest to in lookahead seconds if it keeps moving like this;
+    // -1 if that's the current station, or the knob is (nearly) still
+    int predict_station(double lookahead);
 };
 
 #endif